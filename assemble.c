@@ -0,0 +1,283 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Built-in two-pass LC-2K assembler, see assemble.h
+ *
+ * The first pass splits every line into its label and tokens, in place in
+ * the mapped file, and collects the labels. The second encodes each line
+ * into instrMem, looking labels up in a copy of the table sorted by name.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assemble.h"
+
+#define MAXTOKENS 4 // opcode and up to three fields
+
+typedef struct tokenStruct {
+    const char* text;
+    int len;
+} tokenType;
+
+typedef struct lineStruct {
+    tokenType label; // len 0 for none
+    tokenType tokens[MAXTOKENS];
+    int numTokens;
+    int lineNum;
+} lineType;
+
+typedef struct asmStruct {
+    const char* filename;
+    FILE* out;
+    lineType* lines;
+    int numLines;
+    symbolType* symbols; // in address order
+    symbolType* byName;
+    int numSymbols;
+} asmType;
+
+static const char* const mnemonics[] = {"add", "nor", "lw", "sw", "beq", "jalr", "halt", "noop"};
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static bool isLetter(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static bool tokenIs(const tokenType* t, const char* str) {
+    return (int) strlen(str) == t->len && !memcmp(t->text, str, t->len);
+}
+
+static int error(asmType* as, int lineNum, const char* message, const tokenType* t) {
+    fprintf(as->out, "error: %s line %d: %s", as->filename, lineNum, message);
+    if (t != NULL) {
+        fprintf(as->out, " %.*s", t->len, t->text);
+    }
+    fprintf(as->out, "\n");
+    return -1;
+}
+
+static int compareNames(const void* a, const void* b) {
+    return strcmp(((const symbolType*) a)->name, ((const symbolType*) b)->name);
+}
+
+/* Parses a whole token as a decimal integer. */
+static bool parseNumber(const tokenType* t, long long* value) {
+    int i = 0;
+    bool negative = false;
+    if (t->len > 0 && (t->text[0] == '-' || t->text[0] == '+')) {
+        negative = t->text[0] == '-';
+        ++i;
+    }
+    if (i == t->len) {
+        return false;
+    }
+    long long v = 0;
+    for (; i < t->len; ++i) {
+        if (!isDigit(t->text[i]) || v > 1ll << 40) {
+            return false;
+        }
+        v = v * 10 + (t->text[i] - '0');
+    }
+    *value = negative ? -v : v;
+    return true;
+}
+
+/* Splits the text into lines, skipping blank ones, and records labels. */
+static int firstPass(asmType* as, const char* text, size_t size) {
+    const char* end = text + size;
+    int maxLines = 0;
+    for (int lineNum = 1; text < end; ++lineNum) {
+        const char* newline = memchr(text, '\n', (size_t) (end - text));
+        const char* lineEnd = newline != NULL ? newline : end;
+        lineType line = {{text, 0}, {{NULL, 0}}, 0, lineNum};
+
+        const char* p = text;
+        while (p < lineEnd && !isBlank(*p)) {
+            ++p;
+        }
+        line.label.len = (int) (p - text);
+        while (line.numTokens < MAXTOKENS) {
+            while (p < lineEnd && isBlank(*p)) {
+                ++p;
+            }
+            if (p == lineEnd) {
+                break;
+            }
+            tokenType* t = &line.tokens[line.numTokens++];
+            t->text = p;
+            while (p < lineEnd && !isBlank(*p)) {
+                ++p;
+            }
+            t->len = (int) (p - t->text);
+        }
+        text = lineEnd + (newline != NULL);
+        if (line.label.len == 0 && line.numTokens == 0) {
+            continue;
+        }
+
+        if (as->numLines == NUMMEMORY) {
+            return error(as, lineNum, "program does not fit in memory", NULL);
+        }
+        if (line.numTokens == 0) {
+            return error(as, lineNum, "missing opcode after label", &line.label);
+        }
+        if (as->numLines == maxLines) {
+            maxLines = maxLines ? maxLines * 2 : 256;
+            as->lines = realloc(as->lines, maxLines * sizeof(lineType));
+            as->symbols = realloc(as->symbols, maxLines * sizeof(symbolType));
+            if (as->lines == NULL || as->symbols == NULL) {
+                printf("error: out of memory for assembling %s\n", as->filename);
+                exit(1);
+            }
+        }
+        if (line.label.len > 0) {
+            const tokenType* label = &line.label;
+            bool valid = label->len <= MAXLABEL && isLetter(label->text[0]);
+            for (int i = 1; i < label->len; ++i) {
+                valid &= isLetter(label->text[i]) || isDigit(label->text[i]);
+            }
+            if (!valid) {
+                return error(as, lineNum, "bad label", label);
+            }
+            symbolType* symbol = &as->symbols[as->numSymbols++];
+            memcpy(symbol->name, label->text, label->len);
+            symbol->name[label->len] = '\0';
+            symbol->addr = as->numLines;
+        }
+        as->lines[as->numLines++] = line;
+    }
+
+    as->byName = malloc((as->numSymbols + 1) * sizeof(symbolType));
+    if (as->byName == NULL) {
+        printf("error: out of memory for assembling %s\n", as->filename);
+        exit(1);
+    }
+    memcpy(as->byName, as->symbols, as->numSymbols * sizeof(symbolType));
+    qsort(as->byName, as->numSymbols, sizeof(symbolType), compareNames);
+    for (int i = 1; i < as->numSymbols; ++i) {
+        if (!strcmp(as->byName[i].name, as->byName[i - 1].name)) {
+            int addr = as->byName[i].addr > as->byName[i - 1].addr ? as->byName[i].addr : as->byName[i - 1].addr;
+            return error(as, as->lines[addr].lineNum, "duplicate label", &as->lines[addr].label);
+        }
+    }
+    return 0;
+}
+
+/* Finds a label's address, or returns -1. */
+static int lookup(asmType* as, const tokenType* t) {
+    if (t->len > MAXLABEL) {
+        return -1;
+    }
+    symbolType key;
+    memcpy(key.name, t->text, t->len);
+    key.name[t->len] = '\0';
+    symbolType* found = bsearch(&key, as->byName, as->numSymbols, sizeof(symbolType), compareNames);
+    return found != NULL ? found->addr : -1;
+}
+
+static int parseRegister(asmType* as, const lineType* line, int field, int* reg) {
+    long long value;
+    if (!parseNumber(&line->tokens[field], &value) || value < 0 || value >= NUMREGS) {
+        return error(as, line->lineNum, "bad register", &line->tokens[field]);
+    }
+    *reg = (int) value;
+    return 0;
+}
+
+/* A number, or a label's address (relative to the next instruction for
+   beq). */
+static int parseValue(asmType* as, const lineType* line, int field, int addr, int op, long long* value) {
+    const tokenType* t = &line->tokens[field];
+    if (parseNumber(t, value)) {
+        return 0;
+    }
+    int target = lookup(as, t);
+    if (target < 0) {
+        return error(as, line->lineNum, "undefined label", t);
+    }
+    *value = op == BEQ ? target - (addr + 1) : target;
+    return 0;
+}
+
+static int encodeLine(asmType* as, const lineType* line, int addr, int* word) {
+    const tokenType* opToken = &line->tokens[0];
+    int op = -1;
+    for (int i = 0; i < (int) (sizeof(mnemonics) / sizeof(mnemonics[0])); ++i) {
+        if (tokenIs(opToken, mnemonics[i])) {
+            op = i;
+        }
+    }
+    bool fill = tokenIs(opToken, ".fill");
+    if (op < 0 && !fill) {
+        return error(as, line->lineNum, "unrecognized opcode", opToken);
+    }
+    int numFields = fill ? 1 : op <= BEQ ? 3 : op == JALR ? 2 : 0;
+    if (line->numTokens - 1 < numFields) {
+        return error(as, line->lineNum, "missing fields for", opToken);
+    }
+
+    long long value;
+    if (fill) {
+        if (parseValue(as, line, 1, addr, -1, &value) != 0) {
+            return -1;
+        }
+        if (value < -2147483648ll || value > 2147483647ll) {
+            return error(as, line->lineNum, ".fill value out of range", &line->tokens[1]);
+        }
+        *word = (int) value;
+        return 0;
+    }
+    int regA = 0, regB = 0, field2 = 0;
+    if (numFields >= 2 && (parseRegister(as, line, 1, &regA) != 0 || parseRegister(as, line, 2, &regB) != 0)) {
+        return -1;
+    }
+    if (op == ADD || op == NOR) {
+        if (parseRegister(as, line, 3, &field2) != 0) {
+            return -1;
+        }
+    } else if (op == LW || op == SW || op == BEQ) {
+        if (parseValue(as, line, 3, addr, op, &value) != 0) {
+            return -1;
+        }
+        if (value < -32768 || value > 32767) {
+            return error(as, line->lineNum, "offset does not fit in 16 bits:", &line->tokens[3]);
+        }
+        field2 = (int) value & 0xffff;
+    }
+    *word = (op << 22) | (regA << 19) | (regB << 16) | field2;
+    return 0;
+}
+
+/* Assembles text into instrMem, which must be empty. On success returns 0
+   and the labels in address order, which the caller owns. Otherwise
+   prints an error to out and returns -1. */
+int assembleProgram(memoryType* mem, const char* filename, const char* text, size_t size, FILE* out,
+        symbolType** symbols, int* numSymbols) {
+    asmType as = {filename, out, NULL, 0, NULL, NULL, 0};
+    int status = firstPass(&as, text, size);
+    for (int addr = 0; status == 0 && addr < as.numLines; ++addr) {
+        int word = 0;
+        status = encodeLine(&as, &as.lines[addr], addr, &word);
+        if (status == 0) {
+            storeInstr(mem, addr, word);
+        }
+    }
+    free(as.lines);
+    free(as.byName);
+    if (status != 0) {
+        free(as.symbols);
+        return -1;
+    }
+    mem->numMemory = as.numLines;
+    *symbols = as.symbols;
+    *numSymbols = as.numSymbols;
+    return 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Built-in two-pass LC-2K assembler, so .as files load without a .mc step
+ *
+ * Each line is an optional label starting in the first column, an opcode
+ * and its fields, separated by blanks, and anything after the fields is a
+ * comment. Labels are up to MAXLABEL letters and digits, starting with a
+ * letter. add and nor take regA regB destReg, lw, sw and beq take regA
+ * regB offset, jalr takes regA regB, halt and noop take nothing, and .fill
+ * takes one value. An offset or .fill value may be a label: lw and sw
+ * use its address, beq the distance from the next instruction to it.
+ * Registers must be 0 to 7 and offsets must fit in 16 bits.
+ *
+ * The words go straight into instruction memory, and the labels are kept
+ * in the decoded program (see memoryLabel) to annotate pcs with.
+**/
+
+#ifndef ASSEMBLE_H
+#define ASSEMBLE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "lc2k.h"
+
+int assembleProgram(memoryType*, const char* filename, const char* text, size_t size, FILE* out,
+    symbolType** symbols, int* numSymbols);
+
+#endif
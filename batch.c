@@ -0,0 +1,342 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Batch runner: simulate many programs in parallel and check each against
+ * its *.out.correct
+ *
+ * Each worker thread owns a memoryType and a pipeline and runs programs
+ * in-process. The text each run would print goes into a stdio stream whose
+ * write callback compares it against the mapped *.out.correct as it is
+ * produced, so no output file is ever written. A run stops at its first
+ * mismatching byte.
+ *
+ * Programs are dealt round-robin onto per-worker deques. A worker takes
+ * work from the bottom of its own deque and, once that is empty, steals
+ * from the top of the others'.
+**/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "lc2k.h"
+#include "pipeline.h"
+#include "loader.h"
+#include "filelist.h"
+
+typedef enum {
+    jobPass,
+    jobFail,
+    jobError
+} jobStatus;
+
+typedef struct jobStruct {
+    char* program; // path of the .mc file
+    char* expected; // path of the matching .out.correct
+    jobStatus status;
+    unsigned int cycles;
+    int divergeCycle; // -1 if the listing already differs
+    size_t divergeOffset;
+    char message[128];
+} jobType;
+
+typedef struct dequeStruct {
+    pthread_mutex_t lock;
+    int* items; // job indices
+    int top; // next to steal
+    int bottom; // one past the next the owner runs
+} dequeType;
+
+typedef struct workerStruct {
+    int id;
+    struct batchStruct* batch;
+    memoryType* mem;
+    pipelineType pipeline;
+    pthread_t thread;
+} workerType;
+
+typedef struct batchStruct {
+    jobType* jobs;
+    int numJobs;
+    dequeType* deques;
+    workerType* workers;
+    int numWorkers;
+} batchType;
+
+/* ------------------------ streaming compare ------------------------ */
+
+typedef struct compareSinkStruct {
+    const char* expected;
+    size_t expectedLen;
+    size_t pos; // bytes of output seen so far
+    bool diverged;
+    size_t divergeOffset;
+} compareSinkType;
+
+static ssize_t compareWrite(void* cookie, const char* buf, size_t size) {
+    compareSinkType* sink = cookie;
+    if (!sink->diverged) {
+        size_t avail = sink->expectedLen - sink->pos;
+        size_t n = size < avail ? size : avail;
+        const char* exp = sink->expected + sink->pos;
+        for (size_t i = 0; i < n; ++i) {
+            if (buf[i] != exp[i]) {
+                sink->diverged = true;
+                sink->divergeOffset = sink->pos + i;
+                break;
+            }
+        }
+        if (!sink->diverged && size > avail) {
+            sink->diverged = true;
+            sink->divergeOffset = sink->expectedLen;
+        }
+    }
+    sink->pos += size;
+    return (ssize_t) size;
+}
+
+/* The cycle whose printed state contains byte offset of the expected
+   output, or -1 if offset falls in the instruction memory listing. */
+static int cycleAtOffset(const char* text, size_t textLen, size_t offset) {
+    static const char marker[] = "state before cycle ";
+    size_t len = sizeof(marker) - 1;
+    for (size_t i = offset < textLen ? offset + 1 : textLen; i-- > 0;) {
+        if (i + len <= textLen && !strncmp(text + i, marker, len)) {
+            return atoi(text + i + len);
+        }
+    }
+    return -1;
+}
+
+static void runJob(workerType* worker, jobType* job) {
+    int fd = open(job->expected, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        job->status = jobError;
+        snprintf(job->message, sizeof(job->message), "can't open %s", job->expected);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    compareSinkType sink;
+    memset(&sink, 0, sizeof(sink));
+    sink.expectedLen = (size_t) st.st_size;
+    sink.expected = "";
+    void* mapped = NULL;
+    if (sink.expectedLen > 0) {
+        mapped = mmap(NULL, sink.expectedLen, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            job->status = jobError;
+            snprintf(job->message, sizeof(job->message), "can't map %s", job->expected);
+            return;
+        }
+        sink.expected = mapped;
+    }
+    close(fd);
+
+    cookie_io_functions_t funcs = {NULL, compareWrite, NULL, NULL};
+    FILE* out = fopencookie(&sink, "w", funcs);
+    if (out == NULL) {
+        job->status = jobError;
+        snprintf(job->message, sizeof(job->message), "can't open output stream");
+    } else {
+        setvbuf(out, NULL, _IOFBF, 1 << 16);
+        pipelineType* p = &worker->pipeline;
+        if (loadMachineCode(worker->mem, job->program, out, true) == 0) {
+            pipelineInit(p, worker->mem);
+            while (!pipelineHalted(p) && !sink.diverged) {
+                fprintState(out, p->state);
+                pipelineCycle(p);
+            }
+            if (!sink.diverged) {
+                fprintHalted(out, p->state);
+            }
+            job->cycles = p->state->cycles;
+        }
+        fclose(out);
+
+        if (!sink.diverged && sink.pos < sink.expectedLen) {
+            sink.diverged = true;
+            sink.divergeOffset = sink.pos;
+        }
+        job->status = sink.diverged ? jobFail : jobPass;
+        job->divergeOffset = sink.divergeOffset;
+        job->divergeCycle = sink.diverged ? cycleAtOffset(sink.expected, sink.expectedLen, sink.divergeOffset) : 0;
+    }
+    if (mapped != NULL) {
+        munmap(mapped, sink.expectedLen);
+    }
+}
+
+/* ---------------------------- thread pool --------------------------- */
+
+static int popOwn(dequeType* deque) {
+    int job = -1;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        job = deque->items[--deque->bottom];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return job;
+}
+
+static int steal(dequeType* deque) {
+    int job = -1;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) {
+        job = deque->items[deque->top++];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return job;
+}
+
+static void* workerMain(void* arg) {
+    workerType* worker = arg;
+    batchType* batch = worker->batch;
+    for (;;) {
+        int job = popOwn(&batch->deques[worker->id]);
+        for (int i = 1; job < 0 && i < batch->numWorkers; ++i) {
+            job = steal(&batch->deques[(worker->id + i) % batch->numWorkers]);
+        }
+        // nothing new is ever queued, so empty everywhere means done
+        if (job < 0) {
+            return NULL;
+        }
+        runJob(worker, &batch->jobs[job]);
+    }
+}
+
+/* --------------------------- job discovery -------------------------- */
+
+static void addJob(batchType* batch, int* capacity, const char* program) {
+    if (batch->numJobs == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        batch->jobs = realloc(batch->jobs, *capacity * sizeof(jobType));
+        if (batch->jobs == NULL) {
+            printf("error: out of memory for batch jobs\n");
+            exit(1);
+        }
+    }
+    jobType* job = &batch->jobs[batch->numJobs++];
+    memset(job, 0, sizeof(*job));
+    job->program = strdup(program);
+    size_t len = strlen(program);
+    if (len > 3 && !strcmp(program + len - 3, ".mc")) {
+        len -= 3;
+    }
+    job->expected = malloc(len + sizeof(".out.correct"));
+    if (job->program == NULL || job->expected == NULL) {
+        printf("error: out of memory for batch jobs\n");
+        exit(1);
+    }
+    memcpy(job->expected, program, len);
+    strcpy(job->expected + len, ".out.correct");
+}
+
+/* source is either a directory, whose *.mc files are all run, or a text
+   file listing one .mc path per line. */
+static void findJobs(batchType* batch, const char* source) {
+    int capacity = 0;
+    int numPaths;
+    char** paths = fileListCreate(source, ".mc", &numPaths);
+    for (int i = 0; i < numPaths; ++i) {
+        addJob(batch, &capacity, paths[i]);
+    }
+    fileListFree(paths, numPaths);
+}
+
+/* ------------------------------- driver ----------------------------- */
+
+/* Runs every program named by source on numWorkers threads and prints one
+   line per program plus a summary. Returns 0 if every program matched its
+   expected output. */
+int runBatch(const char* source, int numWorkers) {
+    batchType batch;
+    memset(&batch, 0, sizeof(batch));
+    findJobs(&batch, source);
+    if (numWorkers < 1) {
+        numWorkers = 1;
+    }
+    if (numWorkers > batch.numJobs && batch.numJobs > 0) {
+        numWorkers = batch.numJobs;
+    }
+    batch.numWorkers = numWorkers;
+    batch.deques = calloc(numWorkers, sizeof(dequeType));
+    batch.workers = calloc(numWorkers, sizeof(workerType));
+    if (batch.deques == NULL || batch.workers == NULL) {
+        printf("error: out of memory for batch workers\n");
+        exit(1);
+    }
+
+    for (int w = 0; w < numWorkers; ++w) {
+        dequeType* deque = &batch.deques[w];
+        pthread_mutex_init(&deque->lock, NULL);
+        deque->items = malloc((batch.numJobs / numWorkers + 1) * sizeof(int));
+        // push in reverse so the owner pops jobs in listed order
+        for (int j = batch.numJobs - 1; j >= 0; --j) {
+            if (j % numWorkers == w) {
+                deque->items[deque->bottom++] = j;
+            }
+        }
+        workerType* worker = &batch.workers[w];
+        worker->id = w;
+        worker->batch = &batch;
+        worker->mem = calloc(1, sizeof(memoryType));
+        if (deque->items == NULL || worker->mem == NULL) {
+            printf("error: out of memory for batch workers\n");
+            exit(1);
+        }
+    }
+
+    for (int w = 1; w < numWorkers; ++w) {
+        if (pthread_create(&batch.workers[w].thread, NULL, workerMain, &batch.workers[w]) != 0) {
+            printf("error: can't start batch worker thread\n");
+            exit(1);
+        }
+    }
+    workerMain(&batch.workers[0]);
+    for (int w = 1; w < numWorkers; ++w) {
+        pthread_join(batch.workers[w].thread, NULL);
+    }
+
+    int counts[3] = {0, 0, 0};
+    for (int j = 0; j < batch.numJobs; ++j) {
+        jobType* job = &batch.jobs[j];
+        ++counts[job->status];
+        if (job->status == jobPass) {
+            printf("PASS  %s (%u cycles)\n", job->program, job->cycles);
+        } else if (job->status == jobError) {
+            printf("ERROR %s: %s\n", job->program, job->message);
+        } else if (job->divergeCycle < 0) {
+            printf("FAIL  %s: differs in the instruction memory listing (byte %zu)\n",
+                job->program, job->divergeOffset);
+        } else {
+            printf("FAIL  %s: first divergence at cycle %d (byte %zu)\n",
+                job->program, job->divergeCycle, job->divergeOffset);
+        }
+        free(job->program);
+        free(job->expected);
+    }
+    printf("%d passed, %d failed, %d errors (%d programs, %d threads)\n",
+        counts[jobPass], counts[jobFail], counts[jobError], batch.numJobs, numWorkers);
+
+    for (int w = 0; w < numWorkers; ++w) {
+        pthread_mutex_destroy(&batch.deques[w].lock);
+        free(batch.deques[w].items);
+        memoryReset(batch.workers[w].mem);
+        free(batch.workers[w].mem);
+    }
+    free(batch.deques);
+    free(batch.workers);
+    free(batch.jobs);
+    return counts[jobPass] == batch.numJobs ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Batch runner: simulate many programs in parallel and check each against
+ * its *.out.correct
+**/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+int runBatch(const char* source, int jobs);
+
+#endif
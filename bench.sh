@@ -0,0 +1,168 @@
+#!/bin/sh
+# Simulator throughput benchmark, run by `make bench`
+#
+# usage: bench.sh [--compare <baseline>] [--save <baseline>]
+#
+# Runs every benchgen workload in every output mode and prints host
+# simulated cycles/second and instructions/second. Each run is repeated
+# with a larger workload until it takes at least BENCH_MINTIME ms (default
+# 300), so start-up cost does not dominate, and then the fastest of
+# BENCH_REPEAT runs (default 3) is kept. With --compare, each mode's
+# instructions/second is checked against a baseline saved by --save, and
+# the script exits non-zero if any fell more than BENCH_TOLERANCE percent
+# (default 50) below it. Each ratio is taken relative to the median ratio
+# over all modes, which stands for how much faster or slower this host is
+# than the one that recorded the baseline, so the checked-in baseline
+# still compares on another machine. A mode fails when it slowed down
+# against the others, not when the whole machine is slower.
+
+SIM=./simulator
+GEN=./benchgen
+MINTIME=${BENCH_MINTIME:-300}
+REPEAT=${BENCH_REPEAT:-3}
+TOLERANCE=${BENCH_TOLERANCE:-50}
+WORKLOADS="loop loaduse branches stream full"
+MODES="print delta every quiet trace functional jit"
+
+compare=
+save=
+while [ $# -gt 0 ]; do
+    case $1 in
+        --compare) compare=$2; shift 2 ;;
+        --save) save=$2; shift 2 ;;
+        *) echo "error: usage: $0 [--compare <baseline>] [--save <baseline>]"; exit 1 ;;
+    esac
+done
+if [ -n "$compare" ] && [ ! -f "$compare" ]; then
+    echo "no baseline $compare; run make bench-baseline to record one"
+    compare=
+fi
+
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+results=$tmp/results
+
+flags() {
+    case $1 in
+        print) echo "" ;;
+        delta) echo "--delta" ;;
+        every) echo "--every 1000" ;;
+        quiet) echo "--quiet" ;;
+        trace) echo "--quiet --trace-bin $tmp/run.trace" ;;
+        functional) echo "--quiet --no-jit --fast-forward 4000000000" ;;
+        jit) echo "--quiet --fast-forward 4000000000" ;;
+    esac
+}
+
+now() {
+    date +%s%N
+}
+
+printf "%-9s %-10s %9s %12s %12s %8s %10s %10s\n" \
+    workload mode count cycles instrs seconds Mcycles/s Minstrs/s
+for workload in $WORKLOADS; do
+    for mode in $MODES; do
+        # printState lists all of memory every cycle, so a 65000-word program
+        # prints 65000 lines a cycle
+        if [ $workload = full ] && [ $mode = print ]; then
+            continue
+        fi
+        count=1
+        while :; do
+            $GEN $workload $count > $tmp/prog.mc || exit 1
+            # the per-cycle modes print too much to keep
+            out=$tmp/out
+            case $mode in
+                print|delta) out=/dev/null ;;
+            esac
+            start=$(now)
+            $SIM --no-listing $(flags $mode) $tmp/prog.mc > $out || exit 1
+            ms=$(( ($(now) - start) / 1000000 ))
+            if [ $ms -ge $MINTIME ] || [ $count -ge 100000000 ]; then
+                break
+            fi
+            # aim a little past MINTIME, growing at most 64x per step
+            count=$(awk -v c=$count -v ms=$ms -v min=$MINTIME 'BEGIN {
+                f = ms > 0 ? 1.2 * min / ms : 64; if (f > 64) f = 64; if (f < 2) f = 2
+                printf "%d", c * f }')
+        done
+        # keep the fastest of REPEAT runs, since other load only slows a run down
+        i=1
+        while [ $i -lt $REPEAT ]; do
+            start=$(now)
+            $SIM --no-listing $(flags $mode) $tmp/prog.mc > $out || exit 1
+            again=$(( ($(now) - start) / 1000000 ))
+            if [ $again -lt $ms ]; then
+                ms=$again
+            fi
+            i=$((i + 1))
+        done
+
+        # the counts come from the timed run where it kept its output
+        case $mode in
+            functional|jit)
+                cycles=-
+                ;;
+            *)
+                if [ $out = /dev/null ]; then
+                    $SIM --no-listing --quiet $tmp/prog.mc > $tmp/out || exit 1
+                fi
+                cycles=$(sed -n 's/^Total of \([0-9]*\) cycles executed$/\1/p' $tmp/out)
+                $SIM --no-listing --quiet --fast-forward 4000000000 $tmp/prog.mc > $tmp/out || exit 1
+                ;;
+        esac
+        instrs=$(sed -n 's/^fast-forwarded \([0-9]*\) instructions.*/\1/p' $tmp/out)
+        instrs=$((instrs + 1)) # the halt
+        echo "$workload $mode $count $cycles $instrs $ms" >> $results
+    done
+done
+
+awk -v compare="$compare" -v save="$save" -v tolerance=$TOLERANCE '
+    function mipsOf(instrs, ms) {
+        return instrs / (ms / 1000) / 1e6
+    }
+    BEGIN {
+        if (compare != "") {
+            while ((getline line < compare) > 0) {
+                split(line, f, " ")
+                if (f[1] !~ /^#/) base[f[1] " " f[2]] = f[3]
+            }
+            # the median ratio over all modes scales the baseline to this host
+            n = 0
+            while ((getline line < ARGV[1]) > 0) {
+                split(line, f, " ")
+                key = f[1] " " f[2]
+                if (key in base && base[key] > 0) {
+                    r = mipsOf(f[5], f[6]) / base[key]
+                    for (i = n++; i > 0 && ratios[i - 1] > r; --i) ratios[i] = ratios[i - 1]
+                    ratios[i] = r
+                }
+            }
+            close(ARGV[1])
+            host = n == 0 ? 1 : n % 2 ? ratios[(n - 1) / 2] : (ratios[n / 2 - 1] + ratios[n / 2]) / 2
+        }
+        if (save != "") print "# workload mode Minstrs/s" > save
+    }
+    {
+        s = $6 / 1000
+        mcps = $4 == "-" ? "-" : sprintf("%.2f", $4 / s / 1e6)
+        mips = mipsOf($5, $6)
+        line = sprintf("%-9s %-10s %9d %12s %12d %8.3f %10s %10.2f", $1, $2, $3, $4, $5, s, mcps, mips)
+        key = $1 " " $2
+        if (key in base && base[key] > 0) {
+            ratio = mips / base[key] / host
+            line = line sprintf("  %5.2fx", ratio)
+            if (ratio < 1 - tolerance / 100) {
+                line = line "  SLOWER"
+                ++slower
+            }
+        }
+        print line
+        if (save != "") printf "%s %s %.4g\n", $1, $2, mips > save
+    }
+    END {
+        if (compare != "") printf "%d of %d modes more than %d%% slower than %s (host %.2fx its speed)\n",
+            slower, NR, tolerance, compare, host
+        if (save != "") print "saved baseline to " save
+        exit slower > 0
+    }' $results
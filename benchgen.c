@@ -0,0 +1,210 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * benchgen: write a synthetic LC-2K workload as machine code
+ *
+ * usage: benchgen <workload> <count> > prog.mc
+ *
+ *   loop      a counted loop of count iterations over independent adds
+ *   loaduse   count iterations of a lw whose result the next add uses
+ *   branches  count iterations of a loop that is mostly taken beqs
+ *   stream    count passes of lw/add/sw over a 1024-word array
+ *   full      a 65000-word straight-line program run count times (at least once)
+ *
+ * Every workload halts, and its run time grows linearly with count.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lc2k.h"
+
+#define MAXWORDS NUMMEMORY
+#define STREAMWORDS 1024
+#define FULLWORDS 65000
+
+typedef struct programStruct {
+    int words[MAXWORDS];
+    int size;
+} programType;
+
+static int emit(programType* prog, int word) {
+    if (prog->size == MAXWORDS) {
+        printf("error: workload does not fit in memory\n");
+        exit(1);
+    }
+    prog->words[prog->size] = word;
+    return prog->size++;
+}
+
+static int instr(int opcode, int regA, int regB, int field2) {
+    return (opcode << 22) | (regA << 19) | (regB << 16) | (field2 & 0xffff);
+}
+
+/* Emits a beq to target, which may not be emitted yet if it is 0. */
+static int branch(programType* prog, int regA, int regB, int target) {
+    return emit(prog, instr(BEQ, regA, regB, target - (prog->size + 1)));
+}
+
+static void patchBranch(programType* prog, int at, int target) {
+    prog->words[at] = instr(BEQ, (prog->words[at] >> 19) & 7, (prog->words[at] >> 16) & 7,
+        target - (at + 1));
+}
+
+/* Where the data words every workload uses live. They come first, right
+   after a branch over them, so that lw/sw can reach them off r0 with a
+   16-bit offset even in the full workload. */
+typedef struct dataStruct {
+    int count;
+    int negOne;
+    int one;
+    int base; // first word of a scratch array, if any
+} dataType;
+
+/* Emits the data words and an array of arrayWords words, then code that
+   puts count in r1, -1 in r2 and 1 in r6. Workloads count r1 down to
+   zero. */
+static void start(programType* prog, dataType* addrs, int count, int arrayWords) {
+    int skip = branch(prog, 0, 0, 0);
+    addrs->count = emit(prog, count);
+    addrs->negOne = emit(prog, -1);
+    addrs->one = emit(prog, 1);
+    addrs->base = prog->size;
+    for (int i = 0; i < arrayWords; ++i) {
+        emit(prog, i);
+    }
+    patchBranch(prog, skip, prog->size);
+    emit(prog, instr(LW, 0, 1, addrs->count));
+    emit(prog, instr(LW, 0, 2, addrs->negOne));
+    emit(prog, instr(LW, 0, 6, addrs->one));
+}
+
+/* Emits the loop test at the top of a counted loop. endLoop patches it
+   once the body is there. */
+static int startLoop(programType* prog) {
+    int top = branch(prog, 1, 0, 0);
+    emit(prog, instr(ADD, 1, 2, 1));
+    return top;
+}
+
+static void endLoop(programType* prog, int top) {
+    branch(prog, 0, 0, top);
+    patchBranch(prog, top, prog->size);
+}
+
+static void genLoop(programType* prog, int count) {
+    dataType addrs;
+    start(prog, &addrs, count, 0);
+    int top = startLoop(prog);
+    for (int i = 0; i < 8; ++i) {
+        emit(prog, instr(ADD, 3 + i % 3, 6, 3 + i % 3));
+    }
+    endLoop(prog, top);
+    emit(prog, instr(HALT, 0, 0, 0));
+}
+
+static void genLoadUse(programType* prog, int count) {
+    dataType addrs;
+    start(prog, &addrs, count, 4);
+    int top = startLoop(prog);
+    for (int i = 0; i < 4; ++i) {
+        emit(prog, instr(LW, 0, 3, addrs.base + i));
+        emit(prog, instr(ADD, 3, 4, 4));
+    }
+    endLoop(prog, top);
+    emit(prog, instr(HALT, 0, 0, 0));
+}
+
+static void genBranches(programType* prog, int count) {
+    dataType addrs;
+    start(prog, &addrs, count, 0);
+    int top = startLoop(prog);
+    for (int i = 0; i < 6; ++i) {
+        // taken, skipping a word that is never executed
+        branch(prog, 0, 0, prog->size + 2);
+        emit(prog, instr(ADD, 6, 6, 6));
+    }
+    endLoop(prog, top);
+    emit(prog, instr(HALT, 0, 0, 0));
+}
+
+static void genStream(programType* prog, int count) {
+    dataType addrs;
+    start(prog, &addrs, count, STREAMWORDS + 1);
+    int size = addrs.base + STREAMWORDS;
+    prog->words[size] = STREAMWORDS;
+    emit(prog, instr(LW, 0, 7, size));
+    int outer = startLoop(prog);
+    emit(prog, instr(ADD, 7, 0, 5)); // r5 walks the array down from its end
+    int inner = branch(prog, 5, 0, 0);
+    emit(prog, instr(ADD, 5, 2, 5));
+    emit(prog, instr(LW, 5, 4, addrs.base));
+    emit(prog, instr(ADD, 4, 6, 4));
+    emit(prog, instr(SW, 5, 4, addrs.base));
+    branch(prog, 0, 0, inner);
+    patchBranch(prog, inner, prog->size);
+    endLoop(prog, outer);
+    emit(prog, instr(HALT, 0, 0, 0));
+}
+
+static void fillBody(programType* prog, int base, int until) {
+    static const int ops[4] = {ADD, NOR, LW, SW};
+    for (int i = 0; prog->size < until; ++i) {
+        switch (ops[i % 4]) {
+            case ADD:
+                emit(prog, instr(ADD, 3, 6, 3));
+                break;
+            case NOR:
+                emit(prog, instr(NOR, 3, 4, 5));
+                break;
+            case LW:
+                emit(prog, instr(LW, 0, 4, base));
+                break;
+            default:
+                emit(prog, instr(SW, 0, 5, base));
+                break;
+        }
+    }
+}
+
+/* A beq reaches only 32767 words, so the jump back to the top goes through
+   a second beq in the middle of the body, which the body steps over. The
+   count is tested at the bottom, so the body runs at least once. */
+static void genFull(programType* prog, int count) {
+    dataType addrs;
+    start(prog, &addrs, count, 1);
+    int top = prog->size;
+    fillBody(prog, addrs.base, FULLWORDS / 2);
+    branch(prog, 0, 0, prog->size + 2);
+    int middle = branch(prog, 0, 0, top);
+    fillBody(prog, addrs.base, FULLWORDS - 4);
+    emit(prog, instr(ADD, 1, 2, 1));
+    branch(prog, 1, 0, prog->size + 2);
+    branch(prog, 0, 0, middle);
+    emit(prog, instr(HALT, 0, 0, 0));
+}
+
+int main(int argc, char* argv[]) {
+    static const char* names[] = {"loop", "loaduse", "branches", "stream", "full"};
+    static void (*const generators[])(programType*, int) = {
+        genLoop, genLoadUse, genBranches, genStream, genFull
+    };
+    char* end;
+    long count = argc == 3 ? strtol(argv[2], &end, 10) : 0;
+    if (argc != 3 || end == argv[2] || *end != '\0' || count < 0 || count > 0x7fffffff) {
+        printf("error: usage: %s loop|loaduse|branches|stream|full <count>\n", argv[0]);
+        exit(1);
+    }
+    static programType prog;
+    for (int i = 0; i < (int) (sizeof(names) / sizeof(names[0])); ++i) {
+        if (!strcmp(argv[1], names[i])) {
+            generators[i](&prog, (int) count);
+            for (int w = 0; w < prog.size; ++w) {
+                printf("%d\n", prog.words[w]);
+            }
+            return 0;
+        }
+    }
+    printf("error: unknown workload %s\n", argv[1]);
+    exit(1);
+}
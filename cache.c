@@ -0,0 +1,209 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Set-associative L1 cache timing model
+**/
+
+#include <stdlib.h>
+
+#include "cache.h"
+
+static bool isPowerOfTwo(int n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+static int log2Int(int n) {
+    int bits = 0;
+    while ((1 << bits) < n) {
+        ++bits;
+    }
+    return bits;
+}
+
+static bool validConfig(const cacheConfigType* config) {
+    return isPowerOfTwo(config->sizeWords) && isPowerOfTwo(config->blockWords)
+        && isPowerOfTwo(config->ways) && config->blockWords * config->ways <= config->sizeWords;
+}
+
+cacheType* cacheCreate(const char* name, const cacheConfigType* config, int missLatency) {
+    if (!validConfig(config) || missLatency < 0) {
+        printf("error: bad %s configuration %d:%d:%d\n", name,
+            config->sizeWords, config->blockWords, config->ways);
+        exit(1);
+    }
+    cacheType* cache = calloc(1, sizeof(cacheType));
+    int numLines = config->sizeWords / config->blockWords;
+    if (cache != NULL) {
+        cache->lines = calloc(numLines, sizeof(cacheLineType));
+    }
+    if (cache == NULL || cache->lines == NULL) {
+        printf("error: out of memory for %s\n", name);
+        exit(1);
+    }
+    cache->name = name;
+    cache->sizeWords = config->sizeWords;
+    cache->blockWords = config->blockWords;
+    cache->ways = config->ways;
+    cache->missLatency = missLatency;
+    cache->blockBits = log2Int(config->blockWords);
+    cache->setMask = numLines / config->ways - 1;
+    return cache;
+}
+
+/* Parses "size:block:ways", all in words, e.g. "256:4:2". */
+bool cacheParseConfig(const char* str, cacheConfigType* config) {
+    char* end;
+    config->sizeWords = (int) strtol(str, &end, 10);
+    if (*end != ':') {
+        return false;
+    }
+    config->blockWords = (int) strtol(end + 1, &end, 10);
+    if (*end != ':') {
+        return false;
+    }
+    config->ways = (int) strtol(end + 1, &end, 10);
+    return *end == '\0' && validConfig(config);
+}
+
+/* What the other caches on the bus do when cache misses on block or
+   writes it while shared: a modified copy is written back, and for a
+   write (exclusive) every copy is invalidated. */
+static void busSnoop(cacheType* cache, unsigned int block, bool exclusive) {
+    busType* bus = cache->bus;
+    for (int i = 0; i < bus->numCaches; ++i) {
+        cacheType* other = bus->caches[i];
+        if (other == cache) {
+            continue;
+        }
+        cacheLineType* set = &other->lines[(block & other->setMask) * other->ways];
+        for (int way = 0; way < other->ways; ++way) {
+            cacheLineType* line = &set[way];
+            if (!line->valid || line->tag != block) {
+                continue;
+            }
+            if (line->dirty) {
+                other->flushes++;
+                line->dirty = false;
+            }
+            if (exclusive) {
+                other->invalidations++;
+                line->valid = false;
+                if (other->lastLine == line) {
+                    other->lastLine = NULL;
+                }
+            }
+            break;
+        }
+    }
+}
+
+/* The full set search behind cacheAccess. */
+int cacheLookup(cacheType* cache, unsigned int block, bool write) {
+    cacheLineType* set = &cache->lines[(block & cache->setMask) * cache->ways];
+    unsigned int tag = block;
+    cache->clock++;
+    if (write) {
+        cache->writes++;
+    } else {
+        cache->reads++;
+    }
+
+    cacheLineType* victim = &set[0];
+    for (int way = 0; way < cache->ways; ++way) {
+        cacheLineType* line = &set[way];
+        if (line->valid && line->tag == tag) {
+            int latency = 0;
+            if (write && !line->dirty && cache->bus != NULL) {
+                busSnoop(cache, block, true);
+                cache->upgrades++;
+                cache->stallCycles += cache->missLatency;
+                latency = cache->missLatency;
+            }
+            line->lastUse = cache->clock;
+            line->dirty |= write;
+            cache->lastLine = line;
+            return latency;
+        }
+        if (!line->valid || (victim->valid && line->lastUse < victim->lastUse)) {
+            victim = line;
+        }
+    }
+
+    if (write) {
+        cache->writeMisses++;
+    } else {
+        cache->readMisses++;
+    }
+    if (victim->valid && victim->dirty) {
+        cache->writebacks++;
+    }
+    if (cache->bus != NULL) {
+        busSnoop(cache, block, write);
+    }
+    victim->valid = true;
+    victim->dirty = write;
+    victim->tag = tag;
+    victim->lastUse = cache->clock;
+    cache->lastLine = victim;
+    cache->stallCycles += cache->missLatency;
+    return cache->missLatency;
+}
+
+void cacheReport(cacheType* cache, FILE* out) {
+    unsigned long long accesses = cache->reads + cache->writes;
+    unsigned long long misses = cache->readMisses + cache->writeMisses;
+    fprintf(out, "%s: %d words, %d-word blocks, %d-way, miss latency %d\n", cache->name,
+        cache->sizeWords, cache->blockWords, cache->ways, cache->missLatency);
+    fprintf(out, "\taccesses %llu (%llu reads, %llu writes), misses %llu (%llu reads, %llu writes)\n",
+        accesses, cache->reads, cache->writes, misses, cache->readMisses, cache->writeMisses);
+    fprintf(out, "\thit rate %.2f%%, writebacks %llu, stall cycles %llu\n",
+        accesses ? 100.0 * (accesses - misses) / accesses : 100.0, cache->writebacks, cache->stallCycles);
+    if (cache->bus != NULL) {
+        fprintf(out, "\tupgrades %llu, invalidated %llu, flushed %llu\n", cache->upgrades,
+            cache->invalidations, cache->flushes);
+    }
+}
+
+busType* busCreate(void) {
+    busType* bus = calloc(1, sizeof(busType));
+    if (bus == NULL) {
+        printf("error: out of memory for a coherence bus\n");
+        exit(1);
+    }
+    return bus;
+}
+
+void busAttach(busType* bus, cacheType* cache) {
+    bus->caches = realloc(bus->caches, (bus->numCaches + 1) * sizeof(cacheType*));
+    if (bus->caches == NULL) {
+        printf("error: out of memory for a coherence bus\n");
+        exit(1);
+    }
+    bus->caches[bus->numCaches++] = cache;
+    cache->bus = bus;
+}
+
+/* Totals over every cache on the bus. Each BusRd or BusRdX is a miss, and
+   each flush and invalidation is one cache answering another's request. */
+void busReport(busType* bus, FILE* out) {
+    unsigned long long reads = 0, readXs = 0, upgrades = 0, invalidations = 0, flushes = 0;
+    for (int i = 0; i < bus->numCaches; ++i) {
+        cacheType* cache = bus->caches[i];
+        reads += cache->readMisses;
+        readXs += cache->writeMisses;
+        upgrades += cache->upgrades;
+        invalidations += cache->invalidations;
+        flushes += cache->flushes;
+    }
+    fprintf(out, "coherence: %llu BusRd, %llu BusRdX, %llu BusUpgr, %llu invalidations, %llu flushes\n",
+        reads, readXs, upgrades, invalidations, flushes);
+}
+
+void busFree(busType* bus) {
+    free(bus->caches);
+    free(bus);
+}
+
+void cacheFree(cacheType* cache) {
+    free(cache->lines);
+    free(cache);
+}
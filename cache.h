@@ -0,0 +1,94 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Set-associative L1 cache timing model
+ *
+ * Only tags are modeled; the data itself stays in instrMem and dataMem.
+ * Sizes are in words, since LC-2K memory is word-addressed. Replacement
+ * is LRU, stores are write-back with write-allocate, and every miss costs
+ * missLatency cycles during which the whole pipeline is frozen.
+ *
+ * Caches attached to a bus are kept coherent with MSI by snooping. A line's
+ * valid and dirty bits are its state: invalid, shared (valid and clean) or
+ * modified (valid and dirty). A read miss (BusRd) makes any modified copy
+ * elsewhere write back and become shared. A write miss (BusRdX) or a write
+ * to a shared line (BusUpgr, which costs missLatency like a miss) writes
+ * back and invalidates every other copy.
+**/
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+
+#include "lc2k.h"
+
+#define DEFAULTMISSLATENCY 10
+
+typedef struct cacheConfigStruct {
+    int sizeWords; // 0 for no cache
+    int blockWords;
+    int ways;
+} cacheConfigType;
+
+typedef struct cacheLineStruct {
+    unsigned int tag;
+    bool valid;
+    bool dirty;
+    unsigned long long lastUse; // value of the cache's clock at the last hit or fill
+} cacheLineType;
+
+typedef struct busStruct {
+    struct cacheStruct** caches;
+    int numCaches;
+} busType;
+
+typedef struct cacheStruct {
+    const char* name;
+    int sizeWords;
+    int blockWords;
+    int ways;
+    int missLatency;
+    int blockBits; // log2(blockWords)
+    unsigned int setMask;
+    cacheLineType* lines; // set s occupies lines[s * ways .. s * ways + ways)
+    cacheLineType* lastLine; // line of the most recent access, or NULL
+    unsigned long long clock;
+    unsigned long long reads, writes;
+    unsigned long long readMisses, writeMisses;
+    unsigned long long writebacks; // dirty blocks evicted
+    unsigned long long stallCycles;
+    busType* bus; // caches this one is coherent with, or NULL
+    unsigned long long upgrades; // BusUpgr sent
+    unsigned long long invalidations; // lines lost to another cache's write
+    unsigned long long flushes; // modified lines written back for another cache
+} cacheType;
+
+cacheType* cacheCreate(const char* name, const cacheConfigType*, int missLatency);
+bool cacheParseConfig(const char* str, cacheConfigType*);
+int cacheLookup(cacheType*, unsigned int block, bool write);
+void cacheReport(cacheType*, FILE*);
+busType* busCreate(void);
+void busAttach(busType*, cacheType*);
+void busReport(busType*, FILE*);
+void busFree(busType*);
+
+/* Looks up the block holding addr, filling it on a miss. Returns the
+   number of cycles the access stalls the pipeline. Straight-line code
+   usually stays in one block, so that case skips the set search, unless
+   it is a write that has to take the line from other caches first. */
+static inline int cacheAccess(cacheType* cache, int addr, bool write) {
+    unsigned int block = (unsigned int) addr >> cache->blockBits;
+    cacheLineType* line = cache->lastLine;
+    if (line != NULL && line->tag == block && (!write || line->dirty || cache->bus == NULL)) {
+        cache->clock++;
+        cache->reads += !write;
+        cache->writes += write;
+        line->lastUse = cache->clock;
+        line->dirty |= write;
+        return 0;
+    }
+    return cacheLookup(cache, block, write);
+}
+void cacheFree(cacheType*);
+
+#endif
@@ -0,0 +1,214 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Checkpoint and restore, see checkpoint.h for the file layout
+**/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "checkpoint.h"
+
+static const char checkpointMagic[8] = "LC2KCKP";
+
+#define PAGEBYTES (CHECKPOINT_PAGEWORDS * sizeof(int))
+#define HEADERBYTES ((sizeof(checkpointHeaderType) + PAGEBYTES - 1) / PAGEBYTES * PAGEBYTES)
+
+// Every latch field, in file order. bools are stored as 0/1.
+#define LATCHFIELD(f) { offsetof(stateType, f), sizeof(((stateType*) 0)->f) }
+static const struct {
+    size_t offset;
+    size_t size;
+} latchFields[CHECKPOINT_NUMLATCHFIELDS] = {
+    LATCHFIELD(IFID.pcPlus1), LATCHFIELD(IFID.instr), LATCHFIELD(IFID.instrIdx),
+    LATCHFIELD(IFID.predTaken), LATCHFIELD(IFID.predIndex),
+
+    LATCHFIELD(IDEX.pcPlus1), LATCHFIELD(IDEX.valA), LATCHFIELD(IDEX.valB),
+    LATCHFIELD(IDEX.offset), LATCHFIELD(IDEX.instr), LATCHFIELD(IDEX.instrIdx),
+    LATCHFIELD(IDEX.valAhazType), LATCHFIELD(IDEX.valAHaz),
+    LATCHFIELD(IDEX.valBHaz), LATCHFIELD(IDEX.valBhazType), LATCHFIELD(IDEX.predTaken),
+    LATCHFIELD(IDEX.predIndex),
+
+    LATCHFIELD(EXMEM.branchTarget), LATCHFIELD(EXMEM.eq), LATCHFIELD(EXMEM.aluResult),
+    LATCHFIELD(EXMEM.valB), LATCHFIELD(EXMEM.instr), LATCHFIELD(EXMEM.instrIdx),
+    LATCHFIELD(EXMEM.valAhazType), LATCHFIELD(EXMEM.valAHaz),
+    LATCHFIELD(EXMEM.valBHaz), LATCHFIELD(EXMEM.valBhazType), LATCHFIELD(EXMEM.predTaken),
+    LATCHFIELD(EXMEM.predIndex),
+
+    LATCHFIELD(MEMWB.writeData), LATCHFIELD(MEMWB.instr), LATCHFIELD(MEMWB.instrIdx),
+    LATCHFIELD(MEMWB.valAhazType), LATCHFIELD(MEMWB.valAHaz),
+    LATCHFIELD(MEMWB.valBHaz), LATCHFIELD(MEMWB.valBhazType),
+
+    LATCHFIELD(WBEND.writeData), LATCHFIELD(WBEND.instr), LATCHFIELD(WBEND.instrIdx),
+    LATCHFIELD(WBEND.valAhazType), LATCHFIELD(WBEND.valAHaz),
+    LATCHFIELD(WBEND.valBHaz), LATCHFIELD(WBEND.valBhazType),
+};
+
+static int32_t getLatchField(stateType* state, int i) {
+    char* p = (char*) state + latchFields[i].offset;
+    return latchFields[i].size == sizeof(bool) ? *(bool*) p : *(int*) p;
+}
+
+static void setLatchField(stateType* state, int i, int32_t value) {
+    char* p = (char*) state + latchFields[i].offset;
+    if (latchFields[i].size == sizeof(bool)) {
+        *(bool*) p = value != 0;
+    } else {
+        *(int*) p = value;
+    }
+}
+
+static uint64_t nonZeroPages(pageType* const* table) {
+    uint64_t pages = 0;
+    for (int page = 0; page < CHECKPOINT_NUMPAGES; ++page) {
+        for (int i = 0; i < CHECKPOINT_PAGEWORDS; ++i) {
+            if (pageLoad(table, page * CHECKPOINT_PAGEWORDS + i)) {
+                pages |= 1ull << page;
+                break;
+            }
+        }
+    }
+    return pages;
+}
+
+static void writePages(FILE* file, pageType* const* table, uint64_t pages) {
+    for (int page = 0; page < CHECKPOINT_NUMPAGES; ++page) {
+        if (pages & (1ull << page)) {
+            int words[CHECKPOINT_PAGEWORDS];
+            for (int i = 0; i < CHECKPOINT_PAGEWORDS; ++i) {
+                words[i] = pageLoad(table, page * CHECKPOINT_PAGEWORDS + i);
+            }
+            fwrite(words, 1, PAGEBYTES, file);
+        }
+    }
+}
+
+/* Saves state at the start of a cycle, before any stage has run, on a
+   pipeline of the given variant. */
+void checkpointWrite(const char* filename, stateType* state, pipelineVariant variant) {
+    memoryType* mem = state->mem;
+    checkpointHeaderType header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, checkpointMagic, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.byteOrder = CHECKPOINT_BYTEORDER;
+    header.variant = variant;
+    header.cycles = state->cycles;
+    header.pc = state->pc;
+    memcpy(header.reg, state->reg, sizeof(header.reg));
+    header.numMemory = mem->numMemory;
+    for (int i = 0; i < CHECKPOINT_NUMLATCHFIELDS; ++i) {
+        header.latches[i] = getLatchField(state, i);
+    }
+    header.instrPages = nonZeroPages(mem->instrPages);
+    header.dataPages = nonZeroPages(mem->dataPages);
+
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) {
+        printf("error: can't open checkpoint file %s\n", filename);
+        exit(1);
+    }
+    static const char zeros[PAGEBYTES];
+    fwrite(&header, 1, sizeof(header), file);
+    fwrite(zeros, 1, HEADERBYTES - sizeof(header), file);
+    writePages(file, mem->instrPages, header.instrPages);
+    writePages(file, mem->dataPages, header.dataPages);
+    if (fclose(file) != 0) {
+        printf("error: failed writing checkpoint file %s\n", filename);
+        exit(1);
+    }
+}
+
+static const char* readPages(const char* src, const char* end, pageType** table, uint64_t pages) {
+    for (int page = 0; page < CHECKPOINT_NUMPAGES; ++page) {
+        if (pages & (1ull << page)) {
+            if (src + PAGEBYTES > end) {
+                return NULL;
+            }
+            int words[CHECKPOINT_PAGEWORDS];
+            memcpy(words, src, PAGEBYTES);
+            for (int i = 0; i < CHECKPOINT_PAGEWORDS; ++i) {
+                pageStore(table, page * CHECKPOINT_PAGEWORDS + i, words[i]);
+            }
+            src += PAGEBYTES;
+        }
+    }
+    return src;
+}
+
+static void checkpointCorrupt(const char* filename) {
+    printf("error: checkpoint file %s is truncated or corrupt\n", filename);
+    exit(1);
+}
+
+/* Maps a checkpoint and rebuilds mem (including decoded[]) and state from
+   it, and says which variant the state belongs to. Pages absent from the
+   file are left zero. */
+void checkpointRead(const char* filename, memoryType* mem, stateType* state, pipelineVariant* variant) {
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        printf("error: can't open checkpoint file %s\n", filename);
+        exit(1);
+    }
+    size_t size = (size_t) st.st_size;
+    if (size < sizeof(checkpointHeaderType)) {
+        checkpointCorrupt(filename);
+    }
+    const char* base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        printf("error: can't map checkpoint file %s\n", filename);
+        exit(1);
+    }
+
+    const checkpointHeaderType* header = (const checkpointHeaderType*) base;
+    if (memcmp(header->magic, checkpointMagic, sizeof(header->magic))) {
+        printf("error: %s is not an LC-2K checkpoint\n", filename);
+        exit(1);
+    }
+    if (header->version != CHECKPOINT_VERSION || header->byteOrder != CHECKPOINT_BYTEORDER) {
+        printf("error: %s was written by an incompatible simulator (version %u)\n",
+            filename, header->version);
+        exit(1);
+    }
+    if (header->numMemory > NUMMEMORY || header->variant >= NUMPIPELINEVARIANTS
+            || header->pc < 0 || header->pc >= NUMMEMORY) {
+        checkpointCorrupt(filename);
+    }
+
+    memoryReset(mem);
+    const char* end = base + size;
+    const char* pages = base + HEADERBYTES;
+    pages = readPages(pages, end, mem->instrPages, header->instrPages);
+    if (pages == NULL || readPages(pages, end, mem->dataPages, header->dataPages) == NULL) {
+        checkpointCorrupt(filename);
+    }
+    mem->numMemory = header->numMemory;
+    decodeMemory(mem);
+
+    *variant = (pipelineVariant) header->variant;
+    memset(state, 0, sizeof(*state));
+    state->mem = mem;
+    state->cycles = header->cycles;
+    state->pc = header->pc;
+    memcpy(state->reg, header->reg, sizeof(state->reg));
+    for (int i = 0; i < CHECKPOINT_NUMLATCHFIELDS; ++i) {
+        setLatchField(state, i, header->latches[i]);
+    }
+    int idx[] = {state->IFID.instrIdx, state->IDEX.instrIdx, state->EXMEM.instrIdx,
+        state->MEMWB.instrIdx, state->WBEND.instrIdx};
+    for (int i = 0; i < 5; ++i) {
+        if (idx[i] < 0 || idx[i] > NOOPINDEX) {
+            checkpointCorrupt(filename);
+        }
+    }
+    munmap((void*) base, size);
+}
@@ -0,0 +1,51 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Checkpoint and restore of the whole pipeline simulator state
+ *
+ * A checkpoint file is a fixed-size header (checkpointHeaderType) holding
+ * the pipeline variant, cycle count, pc, registers and every pipeline
+ * latch field, followed by the non-zero 4 KB pages of instrMem and then
+ * of dataMem. The latches only make sense to the variant that filled
+ * them, so a checkpoint restores onto that variant alone. instrPages and
+ * dataPages say which pages are present. Each page starts on a 4 KB file
+ * offset so the file can be mapped and read in place. All-zero pages,
+ * which includes every page the program never touched, are not stored at
+ * all.
+**/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+#include "lc2k.h"
+#include "pipeline.h"
+
+#define CHECKPOINT_VERSION 5
+#define CHECKPOINT_BYTEORDER 0x01020304u // as seen by the host that wrote it
+#define CHECKPOINT_PAGEWORDS PAGEWORDS // pages are stored as memory holds them
+#define CHECKPOINT_NUMPAGES NUMPAGES
+#define CHECKPOINT_NUMLATCHFIELDS 43
+
+#if CHECKPOINT_NUMPAGES > 64
+#error "instrPages and dataPages hold one bit per page"
+#endif
+
+typedef struct checkpointHeaderStruct {
+    char magic[8]; // "LC2KCKP"
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t variant; // the pipelineVariant that wrote it
+    uint32_t cycles;
+    int32_t pc;
+    int32_t reg[NUMREGS];
+    uint32_t numMemory;
+    int32_t latches[CHECKPOINT_NUMLATCHFIELDS];
+    uint64_t instrPages; // bit i set if instrMem page i is stored
+    uint64_t dataPages;
+} checkpointHeaderType;
+
+void checkpointWrite(const char* filename, stateType* state, pipelineVariant variant);
+void checkpointRead(const char* filename, memoryType* mem, stateType* state, pipelineVariant* variant);
+
+#endif
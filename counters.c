@@ -0,0 +1,78 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Performance counters updated by the pipeline stages, with JSON export
+**/
+
+#include <stdlib.h>
+
+#include "counters.h"
+
+countersType* countersCreate(void) {
+    countersType* counters = calloc(1, sizeof(countersType));
+    if (counters != NULL) {
+        counters->pcs = calloc(NUMMEMORY, sizeof(pcCountersType));
+    }
+    if (counters == NULL || counters->pcs == NULL) {
+        printf("error: out of memory for performance counters\n");
+        exit(1);
+    }
+    return counters;
+}
+
+/* The halt is still in MEM/WB when the simulator stops, so it is counted
+   here rather than by the WB stage. */
+void countersWriteJson(countersType* counters, const char* filename, stateType* finalState) {
+    FILE* out = fopen(filename, "w");
+    if (out == NULL) {
+        printf("error: can't open stats file %s\n", filename);
+        exit(1);
+    }
+    int haltIdx = finalState->MEMWB.instrIdx;
+    unsigned long long retired = counters->retired + 1;
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"cycles\": %u,\n", finalState->cycles);
+    fprintf(out, "  \"instructions\": %llu,\n", retired);
+    fprintf(out, "  \"cpi\": %.6f,\n", (double) finalState->cycles / retired);
+    fprintf(out, "  \"load_use_stalls\": %llu,\n", counters->loadUseStalls);
+    fprintf(out, "  \"raw_stalls\": %llu,\n", counters->rawStalls);
+    fprintf(out, "  \"branch_mispredicts\": %llu,\n", counters->mispredicts);
+    fprintf(out, "  \"branch_flush_cycles\": %llu,\n", counters->flushCycles);
+    fprintf(out, "  \"cache_stall_cycles\": %llu,\n", counters->cacheStallCycles);
+    fprintf(out, "  \"forwarding\": {\"EXMEM\": %llu, \"MEMWB\": %llu, \"WBEND\": %llu},\n",
+        counters->forwards[EXMEM], counters->forwards[MEMWB], counters->forwards[WBEND]);
+
+    fprintf(out, "  \"opcodes\": {");
+    for (int i = 0; i < NUMOPCODES; ++i) {
+        unsigned long long count = counters->opcodes[i] + (i == HALT);
+        fprintf(out, "\"%s\": %llu, ", opcode_to_str_map[i], count);
+    }
+    fprintf(out, "\"other\": %llu},\n", counters->opcodes[NUMOPCODES]);
+
+    fprintf(out, "  \"pcs\": [");
+    const char* sep = "";
+    for (int pc = 0; pc < NUMMEMORY; ++pc) {
+        pcCountersType* c = &counters->pcs[pc];
+        unsigned long long pcRetired = c->retired + (pc == haltIdx);
+        if (pcRetired == 0 && c->stalls == 0) {
+            continue;
+        }
+        const char* label = memoryLabel(finalState->mem, pc);
+        fprintf(out, "%s\n    {\"pc\": %d, ", sep, pc);
+        if (label != NULL) {
+            fprintf(out, "\"label\": \"%s\", ", label);
+        }
+        fprintf(out, "\"retired\": %llu, \"stalls\": %llu}", pcRetired, c->stalls);
+        sep = ",";
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (fclose(out) != 0) {
+        printf("error: failed writing stats file %s\n", filename);
+        exit(1);
+    }
+}
+
+void countersFree(countersType* counters) {
+    free(counters->pcs);
+    free(counters);
+}
@@ -0,0 +1,34 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Performance counters updated by the pipeline stages, with JSON export
+**/
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include "lc2k.h"
+
+#define NUMOPCODES 8
+
+typedef struct pcCountersStruct {
+    unsigned long long retired;
+    unsigned long long stalls; // cycles held in IF/ID for an operand
+} pcCountersType;
+
+typedef struct countersStruct {
+    unsigned long long retired; // non-bubble instructions through WB
+    unsigned long long loadUseStalls;
+    unsigned long long rawStalls; // held in ID for any register still being written, without forwarding
+    unsigned long long flushCycles; // squashed slots, pipelineFlushPenalty per mispredict
+    unsigned long long mispredicts;
+    unsigned long long cacheStallCycles; // frozen waiting for a cache miss
+    unsigned long long forwards[4]; // operands forwarded, by HazType
+    unsigned long long opcodes[NUMOPCODES + 1]; // retired by opcode, last is anything else
+    pcCountersType* pcs; // per instruction address
+} countersType;
+
+countersType* countersCreate(void);
+void countersWriteJson(countersType*, const char* filename, stateType* finalState);
+void countersFree(countersType*);
+
+#endif
@@ -0,0 +1,463 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Time-travel debugging, see debugger.h
+ *
+ * The state is treated as STATEWORDS 32-bit words. Undoing a cycle starts
+ * from a guess at the old state made from the new one: every instruction
+ * moves back one latch and the pc back by one (see guessOld). An undo
+ * record is
+ *   varint mask                   bit i: word i is not the guess, bit 63: a sw
+ *   svarint per set bit           guess - old
+ *   varint addr, svarint          old - new dataMem[addr], if bit 63
+ *   u16 length                    of everything above, to walk backward
+ * and a typical cycle takes under 20 bytes, against 180 for the whole
+ * state. Stores are held by the pipeline (see holdStores) and
+ * committed here, which is when their old value is read.
+**/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "debugger.h"
+
+#define STATEWORDS (offsetof(stateType, cycles) / sizeof(unsigned int))
+#define STOREBIT 63
+
+static inline unsigned int stateWord(const stateType* state, int i) {
+    unsigned int word;
+    memcpy(&word, (const char*) state + i * sizeof(word), sizeof(word));
+    return word;
+}
+
+static inline void setStateWord(stateType* state, int i, unsigned int word) {
+    memcpy((char*) state + i * sizeof(word), &word, sizeof(word));
+}
+
+/* Latch fields whose old value is usually in the next latch now. */
+#define GUESS(oldField, newField) { offsetof(stateType, oldField), offsetof(stateType, newField), \
+    sizeof(((stateType*) 0)->oldField) }
+static const struct {
+    size_t oldOffset;
+    size_t newOffset;
+    size_t size;
+} guesses[] = {
+    GUESS(IFID.pcPlus1, IDEX.pcPlus1), GUESS(IFID.instr, IDEX.instr), GUESS(IFID.instrIdx, IDEX.instrIdx),
+    GUESS(IFID.predTaken, IDEX.predTaken), GUESS(IFID.predIndex, IDEX.predIndex),
+
+    GUESS(IDEX.instr, EXMEM.instr), GUESS(IDEX.instrIdx, EXMEM.instrIdx),
+    GUESS(IDEX.valAhazType, EXMEM.valAhazType), GUESS(IDEX.valAHaz, EXMEM.valAHaz),
+    GUESS(IDEX.valBHaz, EXMEM.valBHaz), GUESS(IDEX.valBhazType, EXMEM.valBhazType),
+    GUESS(IDEX.predTaken, EXMEM.predTaken), GUESS(IDEX.predIndex, EXMEM.predIndex),
+
+    GUESS(EXMEM.aluResult, MEMWB.writeData), GUESS(EXMEM.instr, MEMWB.instr),
+    GUESS(EXMEM.instrIdx, MEMWB.instrIdx), GUESS(EXMEM.valAhazType, MEMWB.valAhazType),
+    GUESS(EXMEM.valAHaz, MEMWB.valAHaz), GUESS(EXMEM.valBHaz, MEMWB.valBHaz),
+    GUESS(EXMEM.valBhazType, MEMWB.valBhazType),
+
+    GUESS(MEMWB.writeData, WBEND.writeData), GUESS(MEMWB.instr, WBEND.instr),
+    GUESS(MEMWB.instrIdx, WBEND.instrIdx), GUESS(MEMWB.valAhazType, WBEND.valAhazType),
+    GUESS(MEMWB.valAHaz, WBEND.valAHaz), GUESS(MEMWB.valBHaz, WBEND.valBHaz),
+    GUESS(MEMWB.valBhazType, WBEND.valBhazType),
+};
+
+/* The forwarding ID would have set up for reading reg, given the
+   instructions now in the later latches. */
+static void guessForward(const decodedType* decoded, const stateType* guess, int reg, bool reads,
+        bool* haz, HazType* hazType) {
+    const int producers[SCOREBOARDDEPTH] = {guess->EXMEM.instrIdx, guess->MEMWB.instrIdx, guess->WBEND.instrIdx};
+    static const HazType sources[SCOREBOARDDEPTH] = {EXMEM, MEMWB, WBEND};
+    *haz = false;
+    *hazType = noHaz;
+    for (int i = 0; reads && i < SCOREBOARDDEPTH; ++i) {
+        if (writtenReg(&decoded[producers[i]]) == reg) {
+            *haz = true;
+            *hazType = sources[i];
+            return;
+        }
+    }
+}
+
+/* The fields that are not passed along are guessed from the instruction
+   in each latch, as if it came right after the one before it and its
+   registers were read from the current register file. */
+static void guessOld(const stateType* state, stateType* guess) {
+    const decodedType* decoded = state->mem->decoded;
+    *guess = *state;
+    guess->pc = state->pc - 1;
+    for (int i = 0; i < (int) (sizeof(guesses) / sizeof(guesses[0])); ++i) {
+        memcpy((char*) guess + guesses[i].oldOffset, (const char*) state + guesses[i].newOffset, guesses[i].size);
+    }
+    const decodedType* idex = &decoded[guess->IDEX.instrIdx];
+    guess->IDEX.pcPlus1 = guess->IDEX.instrIdx + 1;
+    guess->IDEX.valA = state->reg[idex->regA];
+    guess->IDEX.valB = state->reg[idex->regB];
+    guess->IDEX.offset = idex->offset;
+    bool readsA = idex->opcode == ADD || idex->opcode == NOR || idex->opcode == LW || idex->opcode == SW
+        || idex->opcode == BEQ;
+    guessForward(decoded, guess, idex->regA, readsA, &guess->IDEX.valAHaz, &guess->IDEX.valAhazType);
+    guessForward(decoded, guess, idex->regB, readsA && idex->opcode != LW, &guess->IDEX.valBHaz,
+        &guess->IDEX.valBhazType);
+    const decodedType* exmem = &decoded[guess->EXMEM.instrIdx];
+    guess->EXMEM.branchTarget = guess->EXMEM.instrIdx + 1 + exmem->offset;
+    guess->EXMEM.valB = state->reg[exmem->regB];
+    if (state->WBEND.instrIdx > 0 && state->WBEND.instrIdx != NOOPINDEX) {
+        guess->WBEND.instrIdx = state->WBEND.instrIdx - 1;
+        guess->WBEND.instr = decoded[guess->WBEND.instrIdx].instr;
+    }
+}
+
+static inline unsigned int zigzag(unsigned int diff) {
+    return (diff << 1) ^ (0u - (diff >> 31));
+}
+
+static inline unsigned int unzigzag(unsigned int z) {
+    return (z >> 1) ^ (0u - (z & 1));
+}
+
+/* ------------------------- undo log ------------------------- */
+
+static void putByte(debuggerType* db, unsigned char byte) {
+    if (db->logSize == db->maxLog) {
+        db->maxLog = db->maxLog ? db->maxLog * 2 : 1 << 16;
+        db->log = realloc(db->log, db->maxLog);
+        if (db->log == NULL) {
+            printf("error: out of memory for the undo log\n");
+            exit(1);
+        }
+    }
+    db->log[db->logSize++] = byte;
+}
+
+static void putVarint(debuggerType* db, unsigned long long value) {
+    while (value >= 0x80) {
+        putByte(db, (unsigned char) ((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    putByte(db, (unsigned char) value);
+}
+
+static unsigned long long getVarint(const unsigned char** p) {
+    unsigned long long value = 0;
+    for (int shift = 0; ; shift += 7) {
+        unsigned char byte = *(*p)++;
+        value |= (unsigned long long) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+}
+
+static void appendRecord(debuggerType* db, const stateType* old, const stateType* state,
+        bool stored, int addr, int oldValue, int newValue) {
+    size_t start = db->logSize;
+    stateType guess;
+    guessOld(state, &guess);
+    unsigned long long mask = (unsigned long long) stored << STOREBIT;
+    for (int i = 0; i < (int) STATEWORDS; ++i) {
+        if (stateWord(old, i) != stateWord(&guess, i)) {
+            mask |= 1ull << i;
+        }
+    }
+    putVarint(db, mask);
+    for (int i = 0; i < (int) STATEWORDS; ++i) {
+        if (mask & (1ull << i)) {
+            putVarint(db, zigzag(stateWord(&guess, i) - stateWord(old, i)));
+        }
+    }
+    if (stored) {
+        putVarint(db, (unsigned int) addr);
+        putVarint(db, zigzag((unsigned int) oldValue - (unsigned int) newValue));
+    }
+    size_t length = db->logSize - start;
+    putByte(db, (unsigned char) (length & 0xff));
+    putByte(db, (unsigned char) (length >> 8));
+}
+
+/* Where the record starting at pos ends. */
+static size_t skipRecord(const debuggerType* db, size_t pos) {
+    const unsigned char* p = db->log + pos;
+    unsigned long long mask = getVarint(&p);
+    for (int i = 0; i < (int) STATEWORDS; ++i) {
+        if (mask & (1ull << i)) {
+            getVarint(&p);
+        }
+    }
+    if (mask & (1ull << STOREBIT)) {
+        getVarint(&p);
+        getVarint(&p);
+    }
+    return (size_t) (p - db->log) + 2;
+}
+
+/* ------------------------- moving ------------------------- */
+
+static void takeSnapshot(debuggerType* db) {
+    if (db->numSnaps == db->maxSnaps) {
+        db->maxSnaps = db->maxSnaps ? db->maxSnaps * 2 : 64;
+        db->snaps = realloc(db->snaps, db->maxSnaps * sizeof(debugSnapType));
+        if (db->snaps == NULL) {
+            printf("error: out of memory for debugger snapshots\n");
+            exit(1);
+        }
+    }
+    debugSnapType* snap = &db->snaps[db->numSnaps++];
+    memset(&snap->mem, 0, sizeof(snap->mem));
+    memoryShare(&snap->mem, &db->sim->mem);
+    snap->state = *simState(db->sim);
+    snap->logPos = db->logPos;
+}
+
+static void restoreSnapshot(debuggerType* db, const debugSnapType* snap) {
+    pipelineType* p = &db->sim->pipeline;
+    memoryShare(&db->sim->mem, &snap->mem);
+    *p->state = snap->state;
+    p->state->mem = &db->sim->mem;
+    pipelineSync(p);
+    db->logPos = snap->logPos;
+}
+
+/* Runs one cycle, recording it if it has not run before. Returns false if
+   the machine has halted. */
+bool debuggerStep(debuggerType* db) {
+    simType* sim = db->sim;
+    pipelineType* p = &sim->pipeline;
+    if (simHalted(sim)) {
+        return false;
+    }
+    stateType old = *p->state;
+    simStep(sim, 1);
+    int addr = 0, oldValue = 0;
+    if (p->storeHeld) {
+        addr = (int) ((unsigned int) p->heldAddr % NUMMEMORY);
+        oldValue = loadWord(&sim->mem, addr);
+        storeWord(&sim->mem, addr, p->heldValue);
+    }
+
+    if (old.cycles < db->lastCycle) {
+        db->logPos = skipRecord(db, db->logPos);
+    } else {
+        appendRecord(db, &old, p->state, p->storeHeld, addr, oldValue, p->heldValue);
+        db->logPos = db->logSize;
+        db->lastCycle = p->state->cycles;
+        if ((db->lastCycle - db->firstCycle) % DEBUGSNAPCYCLES == 0) {
+            takeSnapshot(db);
+        }
+    }
+    p->storeHeld = false;
+    return true;
+}
+
+/* Undoes the last cycle. Returns false at the first cycle. */
+bool debuggerBack(debuggerType* db) {
+    simType* sim = db->sim;
+    pipelineType* p = &sim->pipeline;
+    stateType* state = p->state;
+    if (state->cycles == db->firstCycle) {
+        return false;
+    }
+    const unsigned char* end = db->log + db->logPos - 2;
+    size_t start = db->logPos - 2 - (end[0] | (size_t) end[1] << 8);
+    const unsigned char* q = db->log + start;
+    unsigned long long mask = getVarint(&q);
+    stateType guess;
+    guessOld(state, &guess);
+    for (int i = 0; i < (int) STATEWORDS; ++i) {
+        unsigned int word = stateWord(&guess, i);
+        if (mask & (1ull << i)) {
+            word -= unzigzag((unsigned int) getVarint(&q));
+        }
+        setStateWord(state, i, word);
+    }
+    if (mask & (1ull << STOREBIT)) {
+        int addr = (int) getVarint(&q);
+        unsigned int diff = unzigzag((unsigned int) getVarint(&q));
+        storeWord(&sim->mem, addr, (int) ((unsigned int) loadWord(&sim->mem, addr) + diff));
+    }
+    state->cycles--;
+    pipelineSync(p);
+    db->logPos = start;
+    return true;
+}
+
+/* Goes to the state before cycle, or as close as the run allows: the
+   first cycle, or halt. Going back further than half the snapshot
+   interval restores the snapshot before it and runs forward instead. */
+void debuggerGoto(debuggerType* db, unsigned int cycle) {
+    cycle = cycle < db->firstCycle ? db->firstCycle : cycle;
+    unsigned int now = simCycles(db->sim);
+    if (cycle < now) {
+        const debugSnapType* snap = &db->snaps[(cycle - db->firstCycle) / DEBUGSNAPCYCLES];
+        if (now - cycle > cycle - snap->state.cycles) {
+            restoreSnapshot(db, snap);
+        }
+    }
+    while (simCycles(db->sim) > cycle && debuggerBack(db)) {
+    }
+    while (simCycles(db->sim) < cycle && debuggerStep(db)) {
+    }
+}
+
+/* Starts recording from the machine's current state. */
+debuggerType* debuggerCreate(simType* sim) {
+    debuggerType* db = calloc(1, sizeof(debuggerType));
+    if (db == NULL) {
+        printf("error: out of memory for the debugger\n");
+        exit(1);
+    }
+    db->sim = sim;
+    sim->pipeline.holdStores = true;
+    db->firstCycle = db->lastCycle = simCycles(sim);
+    takeSnapshot(db);
+    return db;
+}
+
+void debuggerFree(debuggerType* db) {
+    for (int i = 0; i < db->numSnaps; ++i) {
+        memoryReset(&db->snaps[i].mem);
+    }
+    db->sim->pipeline.holdStores = false;
+    free(db->snaps);
+    free(db->log);
+    free(db);
+}
+
+/* ------------------------- commands ------------------------- */
+
+static int watchedValue(debuggerType* db, const watchType* watch) {
+    return watch->isReg ? simReg(db->sim, watch->index) : simMem(db->sim, watch->index);
+}
+
+/* Steps one way until a watched value changes, and reports it. Returns
+   whether it stopped for a watchpoint. */
+static bool runToWatch(debuggerType* db, bool forward, FILE* out) {
+    for (int i = 0; i < db->numWatches; ++i) {
+        db->watches[i].value = watchedValue(db, &db->watches[i]);
+    }
+    while (forward ? debuggerStep(db) : debuggerBack(db)) {
+        for (int i = 0; i < db->numWatches; ++i) {
+            watchType* watch = &db->watches[i];
+            int value = watchedValue(db, watch);
+            if (value != watch->value) {
+                int before = forward ? watch->value : value;
+                int after = forward ? value : watch->value;
+                fprintf(out, "%s[ %d ] changed from %d to %d in cycle %u\n", watch->isReg ? "reg" : "dataMem",
+                    watch->index, before, after, simCycles(db->sim) - forward);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void printWhere(debuggerType* db, FILE* out) {
+    const stateType* state = simState(db->sim);
+    const char* label = memoryLabel(&db->sim->mem, state->pc);
+    fprintf(out, "before cycle %u: pc = %d", state->cycles, state->pc);
+    if (label != NULL) {
+        fprintf(out, " (%s)", label);
+    }
+    fprintf(out, "%s\n", simHalted(db->sim) ? ", halted" : "");
+}
+
+/* Parses an optional count argument; missing means fallback. */
+static bool parseArg(const char* arg, long long fallback, long long* value) {
+    if (arg == NULL) {
+        *value = fallback;
+        return true;
+    }
+    char* end;
+    *value = strtoll(arg, &end, 10);
+    return end != arg && *end == '\0';
+}
+
+/* Runs one command line. Returns false on quit. */
+static bool runCommand(debuggerType* db, char* line, FILE* out) {
+    char* words[4] = {NULL};
+    int numWords = 0;
+    for (char* word = strtok(line, " \t\r\n"); word != NULL && numWords < 4; word = strtok(NULL, " \t\r\n")) {
+        words[numWords++] = word;
+    }
+    if (numWords == 0) {
+        return true;
+    }
+    const char* cmd = words[0];
+    long long n;
+
+    if (!strcmp(cmd, "quit") || !strcmp(cmd, "q")) {
+        return false;
+    } else if ((!strcmp(cmd, "step") || !strcmp(cmd, "s")) && parseArg(words[1], 1, &n) && n >= 0) {
+        for (long long i = 0; i < n && debuggerStep(db); ++i) {
+        }
+        printWhere(db, out);
+    } else if ((!strcmp(cmd, "back") || !strcmp(cmd, "b")) && parseArg(words[1], 1, &n) && n >= 0) {
+        for (long long i = 0; i < n && debuggerBack(db); ++i) {
+        }
+        printWhere(db, out);
+    } else if (!strcmp(cmd, "continue") || !strcmp(cmd, "c")) {
+        runToWatch(db, true, out);
+        printWhere(db, out);
+    } else if (!strcmp(cmd, "reverse") || !strcmp(cmd, "rc")) {
+        runToWatch(db, false, out);
+        printWhere(db, out);
+    } else if ((!strcmp(cmd, "goto") || !strcmp(cmd, "g")) && parseArg(words[1], -1, &n)
+            && n >= 0 && n <= 0xffffffffll) {
+        debuggerGoto(db, (unsigned int) n);
+        printWhere(db, out);
+    } else if (!strcmp(cmd, "watch") && numWords == 3 && parseArg(words[2], -1, &n)
+            && ((!strcmp(words[1], "reg") && n >= 0 && n < NUMREGS)
+                || (!strcmp(words[1], "mem") && n >= 0 && n < NUMMEMORY))) {
+        if (db->numWatches == MAXWATCHES) {
+            fprintf(out, "error: at most %d watchpoints\n", MAXWATCHES);
+            return true;
+        }
+        watchType* watch = &db->watches[db->numWatches++];
+        watch->isReg = !strcmp(words[1], "reg");
+        watch->index = (int) n;
+    } else if (!strcmp(cmd, "unwatch")) {
+        db->numWatches = 0;
+    } else if (!strcmp(cmd, "print") || !strcmp(cmd, "p")) {
+        fprintState(out, (stateType*) simState(db->sim));
+    } else if (!strcmp(cmd, "mem") && parseArg(words[1], -1, &n) && n >= 0 && n < NUMMEMORY) {
+        long long count;
+        if (!parseArg(words[2], 1, &count) || count < 0) {
+            fprintf(out, "error: bad command: %s\n", cmd);
+            return true;
+        }
+        for (long long i = n; i < n + count && i < NUMMEMORY; ++i) {
+            fprintf(out, "\tdataMem[ %lld ] = %d\n", i, simMem(db->sim, (int) i));
+        }
+    } else if (!strcmp(cmd, "info")) {
+        printWhere(db, out);
+        fprintf(out, "recorded cycles %u to %u: %zu bytes of undo log, %d snapshots\n", db->firstCycle,
+            db->lastCycle, db->logSize, db->numSnaps);
+    } else {
+        fprintf(out, "error: bad command: %s\n", cmd);
+    }
+    return true;
+}
+
+/* Reads commands from in until quit or end of input, prompting if in is a
+   terminal. */
+int runDebugger(simType* sim, FILE* in, FILE* out) {
+    debuggerType* db = debuggerCreate(sim);
+    bool prompt = isatty(fileno(in));
+    char line[256];
+    printWhere(db, out);
+    while (true) {
+        if (prompt) {
+            fprintf(out, "(lc2k) ");
+            fflush(out);
+        }
+        if (fgets(line, sizeof(line), in) == NULL || !runCommand(db, line, out)) {
+            break;
+        }
+        fflush(out);
+    }
+    debuggerFree(db);
+    return 0;
+}
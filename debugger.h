@@ -0,0 +1,74 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Time-travel debugging: step the pipeline backward as well as forward
+ *
+ * Every cycle run for the first time appends an undo record to an in-memory
+ * log: which words of the state changed and by how much, and the old value
+ * of any word sw overwrote. Stepping back applies records in reverse, and
+ * stepping forward over cycles already in the log runs them again, which
+ * gives the same result. Every DEBUGSNAPCYCLES cycles a full snapshot is
+ * kept as well, sharing memory pages copy-on-write, so jumping to any cycle
+ * costs at most DEBUGSNAPCYCLES / 2 cycles of undoing or rerunning.
+ *
+ * Commands are read one per line:
+ *   step [N], s        run N cycles (default 1)
+ *   back [N], b        undo N cycles
+ *   continue, c        run until a watched value changes or halt
+ *   reverse, rc        undo until a watched value changes or the start
+ *   goto C, g          go to the state before cycle C
+ *   watch reg R        stop when register R changes
+ *   watch mem A        stop when dataMem[A] changes
+ *   unwatch            remove every watchpoint
+ *   print, p           print the whole state as printState does
+ *   mem A [N]          print N data memory words from A (default 1)
+ *   info               the cycle, the cycles recorded and the log size
+ *   quit, q            stop debugging
+**/
+
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <stdio.h>
+
+#include "sim.h"
+
+#define DEBUGSNAPCYCLES 4096
+#define MAXWATCHES 16
+
+/* A full copy of the machine before a cycle, and where the log was then. */
+typedef struct debugSnapStruct {
+    stateType state;
+    memoryType mem;
+    size_t logPos;
+} debugSnapType;
+
+typedef struct watchStruct {
+    bool isReg;
+    int index; // register or dataMem address
+    int value; // before the cycle being checked
+} watchType;
+
+typedef struct debuggerStruct {
+    simType* sim;
+    unsigned int firstCycle; // the cycle the log starts at
+    unsigned int lastCycle; // the latest cycle the log reaches
+    unsigned char* log; // one undo record per cycle since firstCycle
+    size_t logSize;
+    size_t maxLog;
+    size_t logPos; // end of the record for the cycle before the current one
+    debugSnapType* snaps; // snaps[i] is before firstCycle + i * DEBUGSNAPCYCLES
+    int numSnaps;
+    int maxSnaps;
+    watchType watches[MAXWATCHES];
+    int numWatches;
+} debuggerType;
+
+debuggerType* debuggerCreate(simType*);
+bool debuggerStep(debuggerType*);
+bool debuggerBack(debuggerType*);
+void debuggerGoto(debuggerType*, unsigned int cycle);
+void debuggerFree(debuggerType*);
+
+int runDebugger(simType*, FILE* in, FILE* out);
+
+#endif
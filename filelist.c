@@ -0,0 +1,92 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Finding the files a batch or lockstep run works through, see filelist.h
+**/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "filelist.h"
+
+static void addPath(char*** paths, int* numPaths, int* capacity, const char* dir, const char* name) {
+    if (*numPaths == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        *paths = realloc(*paths, *capacity * sizeof(char*));
+        if (*paths == NULL) {
+            printf("error: out of memory for file list\n");
+            exit(1);
+        }
+    }
+    char* path = dir ? malloc(strlen(dir) + strlen(name) + 2) : strdup(name);
+    if (path == NULL) {
+        printf("error: out of memory for file list\n");
+        exit(1);
+    }
+    if (dir) {
+        sprintf(path, "%s/%s", dir, name);
+    }
+    (*paths)[(*numPaths)++] = path;
+}
+
+static int compareNames(const void* a, const void* b) {
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+/* Returns the paths named by source, which the caller frees with
+   fileListFree. */
+char** fileListCreate(const char* source, const char* suffix, int* numPaths) {
+    char** paths = NULL;
+    int capacity = 0;
+    *numPaths = 0;
+    struct stat st;
+    if (stat(source, &st) != 0) {
+        printf("error: can't open %s\n", source);
+        exit(1);
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(source);
+        if (dir == NULL) {
+            printf("error: can't open directory %s\n", source);
+            exit(1);
+        }
+        size_t suffixLen = strlen(suffix);
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            size_t len = strlen(entry->d_name);
+            if (len > suffixLen && !strcmp(entry->d_name + len - suffixLen, suffix)) {
+                addPath(&paths, numPaths, &capacity, source, entry->d_name);
+            }
+        }
+        closedir(dir);
+        qsort(paths, *numPaths, sizeof(char*), compareNames);
+        return paths;
+    }
+
+    FILE* list = fopen(source, "r");
+    if (list == NULL) {
+        printf("error: can't open list %s\n", source);
+        exit(1);
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), list) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0' && line[0] != '#') {
+            addPath(&paths, numPaths, &capacity, NULL, line);
+        }
+    }
+    fclose(list);
+    return paths;
+}
+
+void fileListFree(char** paths, int numPaths) {
+    for (int i = 0; i < numPaths; ++i) {
+        free(paths[i]);
+    }
+    free(paths);
+}
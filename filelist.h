@@ -0,0 +1,16 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Finding the files a batch or lockstep run works through
+ *
+ * A source is either a directory, whose files ending in the given suffix
+ * are all taken in name order, or a text file listing one path per line.
+ * Blank lines and lines starting with '#' in a list are skipped.
+**/
+
+#ifndef FILELIST_H
+#define FILELIST_H
+
+char** fileListCreate(const char* source, const char* suffix, int* numPaths);
+void fileListFree(char** paths, int numPaths);
+
+#endif
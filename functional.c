@@ -0,0 +1,58 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * ISA-level LC-2K model used to fast-forward to a region of interest
+**/
+
+#include "functional.h"
+#include "scoreboard.h"
+
+/* Executes instructions one at a time on mem and reg, starting at *pc,
+   until maxInstrs have run, the next instruction is at untilPc, or the
+   next instruction is halt. The halt itself is left for the pipeline so
+   it can retire it and print the usual final state. Returns the number of
+   instructions executed and leaves *pc at the next one.
+
+   This must agree with what the pipeline commits: jalr is a noop there,
+   and so are words whose opcode is outside 0..7 and an add or nor whose
+   destination is past the last register. */
+unsigned long long runFunctional(memoryType* mem, int* pcPtr, int* reg,
+        unsigned long long maxInstrs, int untilPc) {
+    const decodedType* decoded = mem->decoded;
+    int pc = *pcPtr;
+    unsigned long long count = 0;
+
+    while (count < maxInstrs && pc != untilPc && pc >= 0 && pc < NUMMEMORY) {
+        const decodedType* d = &decoded[pc];
+        if (d->opcode == HALT) {
+            break;
+        }
+        ++pc;
+        ++count;
+        int dest = writtenReg(d);
+        switch (d->opcode) {
+            case ADD:
+                if (dest >= 0) {
+                    reg[dest] = reg[d->regA] + reg[d->regB];
+                }
+                break;
+            case NOR:
+                if (dest >= 0) {
+                    reg[dest] = ~(reg[d->regA] | reg[d->regB]);
+                }
+                break;
+            case LW:
+                reg[d->regB] = loadWord(mem, reg[d->regA] + d->offset);
+                break;
+            case SW:
+                storeWord(mem, reg[d->regA] + d->offset, reg[d->regB]);
+                break;
+            case BEQ:
+                if (reg[d->regA] == reg[d->regB]) {
+                    pc += d->offset;
+                }
+                break;
+        }
+    }
+    *pcPtr = pc;
+    return count;
+}
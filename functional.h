@@ -0,0 +1,16 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * ISA-level LC-2K model with no pipeline latches or hazard logic
+**/
+
+#ifndef FUNCTIONAL_H
+#define FUNCTIONAL_H
+
+#include "lc2k.h"
+
+#define NOPC (-1) // untilPc value that never matches
+
+unsigned long long runFunctional(memoryType* mem, int* pc, int* reg,
+    unsigned long long maxInstrs, int untilPc);
+
+#endif
@@ -0,0 +1,659 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * fuzz: differential testing of the pipeline against a reference ISA model
+ *
+ * usage: fuzz [--programs N] [--seed S] [-j N]
+ *
+ * Generates N random LC-2K programs (default 100000) and runs each on
+ * every pipeline variant (through sim.h) and on the small interpreter
+ * below, which shares no code with the simulator. The final registers and
+ * memory must agree, and so must the cycle count, which the interpreter
+ * works out for each variant from when every instruction could issue.
+ * Programs are biased toward the sequences the hazard logic has to
+ * get right: instructions mostly read registers written one to three
+ * instructions earlier, lw/sw hit a few shared data words, beqs are often
+ * taken, and halt is often right behind a store, a load or a branch. A few
+ * instructions follow the halt that must never commit.
+ *
+ * Branches only go forward, so every program halts. Program i is built
+ * from seed S + i alone, so any failure can be reproduced with
+ * --programs 1 --seed S+i. Each failure is shrunk to a minimal program
+ * that still fails, printed, and written to fuzz-<seed>.mc.
+ *
+ * Before any random program, the fixed programs in regressions[], each of
+ * which once broke a model, are run the same way, and gshare must predict
+ * a periodic branch at least as well as bimodal does.
+**/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "lc2k.h"
+#include "sim.h"
+#include "predictor.h"
+
+#define MAXINSTRS 48
+#define MAXTAIL 4
+#define NUMDATA 8
+#define MAXWORDS (MAXINSTRS + 1 + MAXTAIL + NUMDATA)
+#define MAXSTORES (MAXINSTRS * 4)
+#define CYCLELIMIT (MAXWORDS * 8 + 64) // far more than any program needs
+
+/* One generated instruction. Branch targets and data words are kept
+   symbolic so the minimizer can delete instructions and reassemble. */
+typedef struct fuzzInstrStruct {
+    int opcode;
+    int regA;
+    int regB;
+    int dest; // add/nor
+    int target; // beq: index of the instruction it jumps to, numInstrs for the halt
+    int slot; // lw/sw off r0: data word it addresses, or -1 to use offset
+    int offset;
+} fuzzInstrType;
+
+typedef struct fuzzProgramStruct {
+    fuzzInstrType instrs[MAXINSTRS];
+    int numInstrs;
+    fuzzInstrType tail[MAXTAIL]; // after the halt, never executed
+    int numTail;
+    int data[NUMDATA];
+} fuzzProgramType;
+
+/* Final state of either model. */
+typedef struct outcomeStruct {
+    int reg[NUMREGS];
+    int storeAddrs[MAXSTORES]; // every word either model stored to
+    int numStores;
+    bool halted;
+    unsigned int cycles[NUMPIPELINEVARIANTS]; // the pipeline fills in only the variant it ran
+} outcomeType;
+
+/* What the reference needs to know about each variant's timing. */
+typedef struct timingStruct {
+    int writeToRead; // least cycles from an add or nor leaving ID to a reader leaving it
+    int loadToRead; // and from a lw
+    int branchToTarget; // cycles from a taken beq leaving ID to its target leaving it
+} timingType;
+
+static const timingType timings[NUMPIPELINEVARIANTS] = {
+    [pipelineForwardMem] = {1, 2, 4},
+    [pipelineForwardEx] = {1, 2, 3},
+    [pipelineStallMem] = {4, 4, 4},
+    [pipelineStallEx] = {4, 4, 3},
+};
+
+typedef struct workerStruct {
+    pthread_t thread;
+    int id;
+    int numWorkers;
+    unsigned long long seed;
+    long long programs;
+    simType* sim;
+    int* refMem; // NUMMEMORY words, zero outside the last program's words and stores
+    outcomeType pipe;
+    outcomeType ref;
+    long long failures;
+    unsigned long long cycles;
+} workerType;
+
+static pthread_mutex_t reportLock = PTHREAD_MUTEX_INITIALIZER;
+
+/* ------------------------------ random ------------------------------ */
+
+static unsigned long long splitmix(unsigned long long* state) {
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// uniform in [0, n)
+static int randBelow(unsigned long long* rng, int n) {
+    return (int) (splitmix(rng) % (unsigned long long) n);
+}
+
+static bool chance(unsigned long long* rng, int percent) {
+    return randBelow(rng, 100) < percent;
+}
+
+/* Programs that once broke a model, as machine code. */
+typedef struct regressionStruct {
+    const char* what;
+    int numWords;
+    int words[MAXWORDS];
+} regressionType;
+
+static const regressionType regressions[] = {
+    {"executed .fill words naming registers 100 and 60000", 6, {1, 2, 3, 100, 60000, HALT << 22}},
+    {"beq 0 0 -30000, which fetches from a pc below 0", 2, {(BEQ << 22) | (-30000 & 0xffff), HALT << 22}},
+};
+
+/* ----------------------------- programs ----------------------------- */
+
+/* A register to read: usually one written in the last few instructions. */
+static int pickSource(unsigned long long* rng, const int* recent) {
+    if (chance(rng, 70)) {
+        return recent[randBelow(rng, 3)];
+    }
+    return randBelow(rng, NUMREGS);
+}
+
+static fuzzInstrType randomInstr(unsigned long long* rng, int index, int numInstrs, int* recent) {
+    static const int ops[] = {ADD, ADD, NOR, LW, LW, LW, SW, SW, BEQ, BEQ, NOOP};
+    fuzzInstrType in = {ops[randBelow(rng, sizeof(ops) / sizeof(ops[0]))], 0, 0, 0, 0, -1, 0};
+    int written = -1;
+    switch (in.opcode) {
+        case ADD:
+        case NOR:
+            in.regA = pickSource(rng, recent);
+            in.regB = pickSource(rng, recent);
+            // now and then a destination past the last register, which writes nothing
+            in.dest = chance(rng, 3) ? NUMREGS + randBelow(rng, 0x10000 - NUMREGS) : 1 + randBelow(rng, NUMREGS - 1);
+            written = in.dest < NUMREGS ? in.dest : -1;
+            break;
+        case LW:
+        case SW:
+            if (chance(rng, 75)) {
+                in.slot = randBelow(rng, NUMDATA);
+            } else {
+                in.regA = pickSource(rng, recent);
+                in.offset = randBelow(rng, 2 * NUMDATA) - NUMDATA / 2;
+            }
+            in.regB = in.opcode == LW ? 1 + randBelow(rng, NUMREGS - 1) : pickSource(rng, recent);
+            written = in.opcode == LW ? in.regB : -1;
+            break;
+        case BEQ:
+            in.regA = pickSource(rng, recent);
+            // comparing a register with itself is a taken branch
+            in.regB = chance(rng, 40) ? in.regA : pickSource(rng, recent);
+            in.target = index + 1 + randBelow(rng, numInstrs - index < 4 ? numInstrs - index : 4);
+            break;
+    }
+    if (written >= 0) {
+        recent[2] = recent[1];
+        recent[1] = recent[0];
+        recent[0] = written;
+    }
+    return in;
+}
+
+static void generate(unsigned long long seed, fuzzProgramType* prog) {
+    unsigned long long rng = seed;
+    int recent[3] = {1, 2, 3};
+    prog->numInstrs = 1 + randBelow(&rng, MAXINSTRS);
+    for (int i = 0; i < prog->numInstrs; ++i) {
+        prog->instrs[i] = randomInstr(&rng, i, prog->numInstrs, recent);
+    }
+    // halt right behind a store, load or taken branch
+    if (chance(&rng, 30)) {
+        static const int lastOps[] = {SW, LW, BEQ};
+        int lastOp = lastOps[randBelow(&rng, 3)];
+        fuzzInstrType* last = &prog->instrs[prog->numInstrs - 1];
+        while (last->opcode != lastOp) {
+            *last = randomInstr(&rng, prog->numInstrs - 1, prog->numInstrs, recent);
+        }
+    }
+    prog->numTail = randBelow(&rng, MAXTAIL + 1);
+    for (int i = 0; i < prog->numTail; ++i) {
+        prog->tail[i] = randomInstr(&rng, 0, 1, recent);
+        if (prog->tail[i].opcode == BEQ) {
+            prog->tail[i].opcode = SW;
+            prog->tail[i].slot = 0;
+        }
+    }
+    for (int i = 0; i < NUMDATA; ++i) {
+        prog->data[i] = chance(&rng, 50) ? randBelow(&rng, 16) - 4 : (int) splitmix(&rng);
+    }
+}
+
+static int encode(const fuzzInstrType* in, int at, int dataBase) {
+    int field2 = 0;
+    switch (in->opcode) {
+        case ADD:
+        case NOR:
+            field2 = in->dest;
+            break;
+        case LW:
+        case SW:
+            field2 = in->slot >= 0 ? dataBase + in->slot : in->offset;
+            break;
+        case BEQ:
+            field2 = in->target - (at + 1);
+            break;
+    }
+    int regA = in->opcode == LW || in->opcode == SW ? (in->slot >= 0 ? 0 : in->regA) : in->regA;
+    return (in->opcode << 22) | (regA << 19) | (in->regB << 16) | (field2 & 0xffff);
+}
+
+/* Lays the program out as code, halt, tail, data. Returns its length. */
+static int assemble(const fuzzProgramType* prog, int* words) {
+    int dataBase = prog->numInstrs + 1 + prog->numTail;
+    int n = 0;
+    for (int i = 0; i < prog->numInstrs; ++i, ++n) {
+        words[n] = encode(&prog->instrs[i], n, dataBase);
+    }
+    words[n++] = HALT << 22;
+    for (int i = 0; i < prog->numTail; ++i, ++n) {
+        words[n] = encode(&prog->tail[i], n, dataBase);
+    }
+    for (int i = 0; i < NUMDATA; ++i) {
+        words[n++] = prog->data[i];
+    }
+    return n;
+}
+
+/* ------------------------------ models ------------------------------ */
+
+static void noteStore(outcomeType* out, int addr) {
+    for (int i = 0; i < out->numStores; ++i) {
+        if (out->storeAddrs[i] == addr) {
+            return;
+        }
+    }
+    if (out->numStores < MAXSTORES) {
+        out->storeAddrs[out->numStores++] = addr;
+    }
+}
+
+static void pipelineStore(void* ctx, int addr, int value) {
+    noteStore(ctx, addr);
+}
+
+/* The ISA, straight from the spec, on refMem. Like the pipeline, it
+   fetches from the program as loaded: a sw changes data memory only, and
+   pc wraps modulo NUMMEMORY.
+   Along the way it times every variant: an instruction leaves ID one
+   cycle after the one before it, later after a taken beq (the pipelines
+   always predict not-taken), and no sooner than the registers it reads
+   are ready. The halt stops the pipeline two cycles after leaving ID. */
+static void runReference(workerType* w, const int* words, int numWords) {
+    outcomeType* out = &w->ref;
+    int* mem = w->refMem;
+    memcpy(mem, words, numWords * sizeof(int));
+    memset(out, 0, sizeof(*out));
+    int* reg = out->reg;
+    int pc = 0;
+    unsigned int issue[NUMPIPELINEVARIANTS]; // when the next instruction can leave ID
+    unsigned int ready[NUMPIPELINEVARIANTS][NUMREGS] = {{0}}; // when a reader of each register can
+    for (int v = 0; v < NUMPIPELINEVARIANTS; ++v) {
+        issue[v] = 2; // fetched in cycle 1
+    }
+    for (int steps = 0; steps < CYCLELIMIT; ++steps) {
+        int instr = pc < numWords ? words[pc] : 0;
+        pc = (pc + 1) & (NUMMEMORY - 1);
+        int op = (instr >> 22) & 7;
+        int a = (instr >> 19) & 7;
+        int b = (instr >> 16) & 7;
+        int offset = (short) (instr & 0xffff);
+        int addr = (reg[a] + offset) & (NUMMEMORY - 1);
+
+        bool readsA = op == ADD || op == NOR || op == LW || op == SW || op == BEQ;
+        bool readsB = readsA && op != LW;
+        int dest = instr & 0xffff; // add/nor; past the last register writes nothing
+        int written = (op == ADD || op == NOR) && dest < NUMREGS ? dest : op == LW ? b : -1;
+        bool taken = op == BEQ && reg[a] == reg[b];
+        for (int v = 0; v < NUMPIPELINEVARIANTS; ++v) {
+            unsigned int at = issue[v];
+            if (readsA && ready[v][a] > at) {
+                at = ready[v][a];
+            }
+            if (readsB && ready[v][b] > at) {
+                at = ready[v][b];
+            }
+            if (written >= 0) {
+                ready[v][written] = at + (op == LW ? timings[v].loadToRead : timings[v].writeToRead);
+            }
+            issue[v] = at + (taken ? timings[v].branchToTarget : 1);
+            out->cycles[v] = at + 2;
+        }
+
+        if (op == HALT) {
+            out->halted = true;
+            return;
+        } else if (op == ADD) {
+            if (dest < NUMREGS) {
+                reg[dest] = reg[a] + reg[b];
+            }
+        } else if (op == NOR) {
+            if (dest < NUMREGS) {
+                reg[dest] = ~(reg[a] | reg[b]);
+            }
+        } else if (op == LW) {
+            reg[b] = mem[addr];
+        } else if (op == SW) {
+            mem[addr] = reg[b];
+            noteStore(out, addr);
+        } else if (op == BEQ && reg[a] == reg[b]) {
+            pc = (pc + offset) & (NUMMEMORY - 1);
+        }
+    }
+}
+
+static void runPipeline(workerType* w, const int* words, int numWords, pipelineVariant variant) {
+    outcomeType* out = &w->pipe;
+    out->numStores = 0;
+    pipelineSetVariant(&w->sim->pipeline, variant);
+    simLoadWords(w->sim, words, numWords);
+    simStep(w->sim, CYCLELIMIT);
+    out->halted = simHalted(w->sim);
+    memcpy(out->reg, simState(w->sim)->reg, sizeof(out->reg));
+    out->cycles[variant] = simCycles(w->sim);
+    w->cycles += simCycles(w->sim);
+}
+
+/* Describes the first difference in why, or returns false if the two
+   models agree. refMem must still hold the reference's memory. */
+static bool differs(workerType* w, int numWords, pipelineVariant variant, char* why, size_t size) {
+    int n = snprintf(why, size, "%s: ", pipelineVariantName(variant));
+    why += n;
+    size -= n;
+    if (w->pipe.halted != w->ref.halted) {
+        snprintf(why, size, "pipeline %s, reference %s", w->pipe.halted ? "halted" : "did not halt",
+            w->ref.halted ? "halted" : "did not halt");
+        return true;
+    }
+    for (int r = 0; r < NUMREGS; ++r) {
+        if (w->pipe.reg[r] != w->ref.reg[r]) {
+            snprintf(why, size, "reg[ %d ] = %d, reference %d", r, w->pipe.reg[r], w->ref.reg[r]);
+            return true;
+        }
+    }
+    const outcomeType* outcomes[2] = {&w->pipe, &w->ref};
+    for (int o = -1; o < 2; ++o) {
+        int count = o < 0 ? numWords : outcomes[o]->numStores;
+        for (int i = 0; i < count; ++i) {
+            int addr = o < 0 ? i : outcomes[o]->storeAddrs[i];
+            if (simMem(w->sim, addr) != w->refMem[addr]) {
+                snprintf(why, size, "dataMem[ %d ] = %d, reference %d", addr,
+                    simMem(w->sim, addr), w->refMem[addr]);
+                return true;
+            }
+        }
+    }
+    if (w->pipe.halted && w->pipe.cycles[variant] != w->ref.cycles[variant]) {
+        snprintf(why, size, "cycles = %u, reference %u", w->pipe.cycles[variant], w->ref.cycles[variant]);
+        return true;
+    }
+    return false;
+}
+
+/* Runs a program on the reference and every variant, stopping at the
+   first variant that differs, and puts refMem back to all zeros. */
+static bool failsWords(workerType* w, const int* words, int numWords, char* why, size_t size) {
+    runReference(w, words, numWords);
+    bool failed = false;
+    for (int v = 0; v < NUMPIPELINEVARIANTS && !failed; ++v) {
+        runPipeline(w, words, numWords, (pipelineVariant) v);
+        failed = differs(w, numWords, (pipelineVariant) v, why, size);
+    }
+    memset(w->refMem, 0, numWords * sizeof(int));
+    for (int i = 0; i < w->ref.numStores; ++i) {
+        w->refMem[w->ref.storeAddrs[i]] = 0;
+    }
+    return failed;
+}
+
+static bool fails(workerType* w, const fuzzProgramType* prog, char* why, size_t size) {
+    int words[MAXWORDS];
+    int numWords = assemble(prog, words);
+    return failsWords(w, words, numWords, why, size);
+}
+
+/* ----------------------------- minimizer ---------------------------- */
+
+static void deleteInstr(fuzzProgramType* prog, int index) {
+    for (int i = index; i < prog->numInstrs - 1; ++i) {
+        prog->instrs[i] = prog->instrs[i + 1];
+    }
+    --prog->numInstrs;
+    for (int i = 0; i < prog->numInstrs; ++i) {
+        if (prog->instrs[i].opcode == BEQ && prog->instrs[i].target > index) {
+            --prog->instrs[i].target;
+        }
+    }
+}
+
+/* Shrinks a failing program while it keeps failing: drops instructions
+   and the tail, turns instructions into noops, and zeroes data words. */
+static void minimize(workerType* w, fuzzProgramType* prog) {
+    char why[128];
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = prog->numInstrs - 1; i >= 0 && prog->numInstrs > 1; --i) {
+            fuzzProgramType smaller = *prog;
+            deleteInstr(&smaller, i);
+            if (fails(w, &smaller, why, sizeof(why))) {
+                *prog = smaller;
+                changed = true;
+            }
+        }
+        for (int i = 0; i < prog->numInstrs; ++i) {
+            if (prog->instrs[i].opcode != NOOP) {
+                fuzzProgramType simpler = *prog;
+                simpler.instrs[i] = (fuzzInstrType) {NOOP, 0, 0, 0, 0, -1, 0};
+                if (fails(w, &simpler, why, sizeof(why))) {
+                    *prog = simpler;
+                    changed = true;
+                }
+            }
+        }
+        while (prog->numTail > 0) {
+            fuzzProgramType shorter = *prog;
+            --shorter.numTail;
+            if (!fails(w, &shorter, why, sizeof(why))) {
+                break;
+            }
+            *prog = shorter;
+            changed = true;
+        }
+        for (int i = 0; i < NUMDATA; ++i) {
+            if (prog->data[i] != 0) {
+                fuzzProgramType simpler = *prog;
+                simpler.data[i] = 0;
+                if (fails(w, &simpler, why, sizeof(why))) {
+                    *prog = simpler;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+static void printWords(const int* words, int numWords) {
+    for (int i = 0; i < numWords; ++i) {
+        printf("\t%4d  %11d  ", i, words[i]);
+        printInstruction(words[i]);
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+static void report(workerType* w, unsigned long long seed, fuzzProgramType* prog, const char* firstWhy) {
+    minimize(w, prog);
+    char why[128];
+    fails(w, prog, why, sizeof(why));
+    int words[MAXWORDS];
+    int numWords = assemble(prog, words);
+
+    char filename[64];
+    snprintf(filename, sizeof(filename), "fuzz-%llu.mc", seed);
+    FILE* file = fopen(filename, "w");
+    if (file != NULL) {
+        for (int i = 0; i < numWords; ++i) {
+            fprintf(file, "%d\n", words[i]);
+        }
+        fclose(file);
+    }
+
+    pthread_mutex_lock(&reportLock);
+    printf("FAIL seed %llu: %s\n", seed, firstWhy);
+    printf("\tminimized to %d words (%s), saved as %s:\n", numWords, why, filename);
+    printWords(words, numWords);
+    pthread_mutex_unlock(&reportLock);
+}
+
+/* ----------------------------- predictors --------------------------- */
+
+#define WORD(opcode, regA, regB, field) (((opcode) << 22) | ((regA) << 19) | ((regB) << 16) | ((field) & 0xffff))
+
+/* A loop whose first beq is taken every other iteration. Bimodal gets it
+   right about half the time; gshare sees the period in its history. */
+static const int periodicBranch[] = {
+    WORD(LW, 0, 1, 9), // r1 = iterations
+    WORD(LW, 0, 3, 10), // r3 = -1
+    WORD(NOR, 2, 2, 2), // loop: r2 is -1, then 0, then -1...
+    WORD(BEQ, 2, 0, 1), // taken when r2 is 0
+    WORD(NOOP, 0, 0, 0),
+    WORD(ADD, 1, 3, 1),
+    WORD(BEQ, 1, 0, 1), // to the halt
+    WORD(BEQ, 0, 0, -6), // to loop
+    WORD(HALT, 0, 0, 0),
+    500,
+    -1,
+};
+
+/* The share of periodicBranch's beqs a predictor of this kind gets right. */
+static double predictorAccuracy(workerType* w, predictorKind kind) {
+    predictorType* pred = predictorCreate(kind, DEFAULTBTBENTRIES);
+    w->sim->pipeline.predictor = pred;
+    pipelineSetVariant(&w->sim->pipeline, pipelineForwardMem);
+    simLoadWords(w->sim, periodicBranch, sizeof(periodicBranch) / sizeof(periodicBranch[0]));
+    simRunUntil(w->sim, simUntilHalt, 0);
+    w->sim->pipeline.predictor = NULL;
+
+    unsigned long long executed = 0, correct = 0;
+    for (int pc = 0; pc < NUMMEMORY; ++pc) {
+        executed += pred->stats[pc].executed;
+        correct += pred->stats[pc].correct;
+    }
+    predictorFree(pred);
+    return executed ? (double) correct / executed : 1.0;
+}
+
+/* Returns 1 if gshare does worse than bimodal on periodicBranch. */
+static long long checkPredictors(workerType* w) {
+    double bimodal = predictorAccuracy(w, predictBimodal);
+    double gshare = predictorAccuracy(w, predictGshare);
+    if (gshare < bimodal) {
+        printf("FAIL predictors: gshare %.2f%% accurate on a periodic branch, bimodal %.2f%%\n",
+            100.0 * gshare, 100.0 * bimodal);
+        return 1;
+    }
+    return 0;
+}
+
+/* ------------------------------ driver ------------------------------ */
+
+/* Runs every regression on w. Returns how many failed. */
+static long long runRegressions(workerType* w) {
+    long long failures = 0;
+    char why[128];
+    for (int i = 0; i < (int) (sizeof(regressions) / sizeof(regressions[0])); ++i) {
+        const regressionType* r = &regressions[i];
+        if (failsWords(w, r->words, r->numWords, why, sizeof(why))) {
+            ++failures;
+            printf("FAIL regression %d, %s: %s\n", i, r->what, why);
+            printWords(r->words, r->numWords);
+        }
+    }
+    return failures;
+}
+
+static void* workerMain(void* arg) {
+    workerType* w = arg;
+    fuzzProgramType prog;
+    char why[128];
+    for (long long i = w->id; i < w->programs; i += w->numWorkers) {
+        unsigned long long seed = w->seed + (unsigned long long) i;
+        generate(seed, &prog);
+        if (fails(w, &prog, why, sizeof(why))) {
+            ++w->failures;
+            report(w, seed, &prog, why);
+        }
+    }
+    return NULL;
+}
+
+static void usage(const char* progName) {
+    printf("error: usage: %s [--programs N] [--seed S] [-j N]\n", progName);
+    exit(1);
+}
+
+static unsigned long long parseCount(const char* progName, const char* str) {
+    char* end;
+    unsigned long long value = strtoull(str, &end, 10);
+    if (end == str || *end != '\0' || str[0] == '-') {
+        usage(progName);
+    }
+    return value;
+}
+
+int main(int argc, char* argv[]) {
+    long long programs = 100000;
+    unsigned long long seed = 1;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int numWorkers = cpus > 0 ? (int) cpus : 1;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 < argc && !strcmp(argv[i], "--programs")) {
+            programs = (long long) parseCount(argv[0], argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "--seed")) {
+            seed = parseCount(argv[0], argv[++i]);
+        } else if (i + 1 < argc && !strcmp(argv[i], "-j")) {
+            numWorkers = (int) parseCount(argv[0], argv[++i]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (numWorkers < 1 || numWorkers > 1024) {
+        usage(argv[0]);
+    }
+
+    workerType* workers = calloc(numWorkers, sizeof(workerType));
+    if (workers == NULL) {
+        printf("error: out of memory for fuzz workers\n");
+        exit(1);
+    }
+    for (int i = 0; i < numWorkers; ++i) {
+        workerType* w = &workers[i];
+        w->id = i;
+        w->numWorkers = numWorkers;
+        w->seed = seed;
+        w->programs = programs;
+        w->sim = simCreate();
+        w->refMem = calloc(NUMMEMORY, sizeof(int));
+        if (w->refMem == NULL) {
+            printf("error: out of memory for fuzz workers\n");
+            exit(1);
+        }
+        simOnStore(w->sim, pipelineStore, &w->pipe);
+    }
+    workers[0].failures = runRegressions(&workers[0]) + checkPredictors(&workers[0]);
+    for (int i = 1; i < numWorkers; ++i) {
+        if (pthread_create(&workers[i].thread, NULL, workerMain, &workers[i]) != 0) {
+            printf("error: can't start fuzz worker thread\n");
+            exit(1);
+        }
+    }
+    workerMain(&workers[0]);
+    long long failures = 0;
+    unsigned long long cycles = 0;
+    for (int i = 0; i < numWorkers; ++i) {
+        if (i > 0) {
+            pthread_join(workers[i].thread, NULL);
+        }
+        failures += workers[i].failures;
+        cycles += workers[i].cycles;
+        simFree(workers[i].sim);
+        free(workers[i].refMem);
+    }
+    free(workers);
+    printf("%lld programs (seeds %llu to %llu), %llu cycles, %lld failed (%d threads)\n",
+        programs, seed, seed + (unsigned long long) programs - 1, cycles, failures, numWorkers);
+    return failures > 0;
+}
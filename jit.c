@@ -0,0 +1,356 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Translation of LC-2K basic blocks to x86-64, see jit.h
+**/
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
+
+#include "jit.h"
+#include "functional.h"
+
+#if defined(__x86_64__)
+
+#include <sys/mman.h>
+
+#define JITCODEBYTES (16 << 20)
+#define JITMAXBLOCKBYTES (JITMAXBLOCK * 72 + 64) // generous bound on one block
+
+/* A translated block, called as block(reg, dataPages, budget, &nextPc).
+   It runs at most budget instructions, stores the pc to continue from and
+   returns what is left of the budget. Inside, rdi holds reg, rsi the data
+   page table, rdx the budget and rcx &nextPc. */
+typedef long long (*blockFn)(int* reg, pageType** dataPages, long long budget, int* nextPc);
+
+/* An exit stub that could be turned into a jump once its target exists. */
+typedef struct jitExitStruct {
+    unsigned char* stub;
+    int next; // next exit to the same pc, or -1
+} jitExitType;
+
+typedef struct jitStruct {
+    const memoryType* mem;
+    int untilPc;
+    unsigned char* code;
+    size_t used;
+    unsigned char* out; // next byte to emit
+    unsigned char* entry[NUMMEMORY]; // translated block starting at each pc, or NULL
+    unsigned int heat[NUMMEMORY]; // times each pc has been a block start
+    int pendingExits[NUMMEMORY]; // head of the exits waiting for each pc
+    jitExitType* exits;
+    int numExits;
+    int maxExits;
+} jitType;
+
+/* Side exits for a sw to a shared page, patched in after the body. */
+typedef struct jitSideExitStruct {
+    unsigned char* rel32;
+    int index; // instruction within the block
+} jitSideExitType;
+
+static void emit8(jitType* jit, int byte) {
+    *jit->out++ = (unsigned char) byte;
+}
+
+static void emit32(jitType* jit, int value) {
+    memcpy(jit->out, &value, 4);
+    jit->out += 4;
+}
+
+static void patchRel32(unsigned char* rel32, const unsigned char* target) {
+    int rel = (int) (target - (rel32 + 4));
+    memcpy(rel32, &rel, 4);
+}
+
+// opcode [rdi + reg * 4] with a 32-bit register operand
+static void emitRegOp(jitType* jit, int rex, int opcode, int hostReg, int reg) {
+    if (rex) {
+        emit8(jit, rex);
+    }
+    emit8(jit, opcode);
+    emit8(jit, 0x40 | (hostReg << 3) | 7);
+    emit8(jit, reg * 4);
+}
+
+static void resetCache(jitType* jit) {
+    jit->used = 0;
+    jit->numExits = 0;
+    memset(jit->entry, 0, sizeof(jit->entry));
+    memset(jit->heat, 0, sizeof(jit->heat));
+    for (int i = 0; i < NUMMEMORY; ++i) {
+        jit->pendingExits[i] = -1;
+    }
+}
+
+static jitType* jitCreate(const memoryType* mem, int untilPc) {
+    jitType* jit = malloc(sizeof(jitType));
+    if (jit == NULL) {
+        return NULL;
+    }
+    jit->code = mmap(NULL, JITCODEBYTES, PROT_READ | PROT_WRITE | PROT_EXEC,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->code == MAP_FAILED) {
+        free(jit);
+        return NULL;
+    }
+    jit->mem = mem;
+    jit->untilPc = untilPc;
+    jit->exits = NULL;
+    jit->maxExits = 0;
+    resetCache(jit);
+    return jit;
+}
+
+static void jitFree(jitType* jit) {
+    munmap(jit->code, JITCODEBYTES);
+    free(jit->exits);
+    free(jit);
+}
+
+static bool canChainTo(const jitType* jit, int pc) {
+    return pc >= 0 && pc < NUMMEMORY && pc != jit->untilPc;
+}
+
+/* Returns to runJit, which continues at nextPc. */
+static void emitReturn(jitType* jit, int nextPc) {
+    emit8(jit, 0xc7); // mov dword [rcx], nextPc
+    emit8(jit, 0x01);
+    emit32(jit, nextPc);
+    emit8(jit, 0x48); // mov rax, rdx
+    emit8(jit, 0x89);
+    emit8(jit, 0xd0);
+    emit8(jit, 0xc3); // ret
+}
+
+/* Leaves the block for nextPc: jumps to its translation if there is one,
+   otherwise returns to runJit and remembers the stub so it can be patched
+   into a jump once nextPc is translated. */
+static void emitExit(jitType* jit, int nextPc, const unsigned char* self, int start) {
+    if (!canChainTo(jit, nextPc)) {
+        emitReturn(jit, nextPc);
+        return;
+    }
+    if (nextPc == start || jit->entry[nextPc] != NULL) {
+        emit8(jit, 0xe9); // jmp rel32
+        emit32(jit, 0);
+        patchRel32(jit->out - 4, nextPc == start ? self : jit->entry[nextPc]);
+        return;
+    }
+    if (jit->numExits == jit->maxExits) {
+        jit->maxExits = jit->maxExits ? jit->maxExits * 2 : 1024;
+        jit->exits = realloc(jit->exits, jit->maxExits * sizeof(jitExitType));
+        if (jit->exits == NULL) {
+            printf("error: out of memory for JIT exits\n");
+            exit(1);
+        }
+    }
+    jitExitType* e = &jit->exits[jit->numExits];
+    e->stub = jit->out;
+    e->next = jit->pendingExits[nextPc];
+    jit->pendingExits[nextPc] = jit->numExits++;
+    emitReturn(jit, nextPc);
+}
+
+/* Translates the block starting at start, or returns NULL if its first
+   instruction has to be interpreted. */
+static unsigned char* translate(jitType* jit, int start) {
+    const decodedType* decoded = jit->mem->decoded;
+
+    // find the end of the block first, since the entry checks its length
+    int len = 0;
+    bool endsInBranch = false;
+    for (int pc = start; pc < NUMMEMORY && len < JITMAXBLOCK; ++pc) {
+        const decodedType* d = &decoded[pc];
+        if (d->opcode == HALT || (pc == jit->untilPc && pc != start)
+                || ((d->opcode == ADD || d->opcode == NOR) && d->dest >= NUMREGS)) {
+            break;
+        }
+        ++len;
+        if (d->opcode == BEQ || d->opcode == JALR) {
+            endsInBranch = d->opcode == BEQ;
+            break;
+        }
+    }
+    if (len == 0) {
+        return NULL;
+    }
+
+    if (jit->used + JITMAXBLOCKBYTES > JITCODEBYTES) {
+        resetCache(jit);
+    }
+    unsigned char* self = jit->code + jit->used;
+    jit->out = self;
+    jitSideExitType sideExits[JITMAXBLOCK];
+    int numSideExits = 0;
+
+    emit8(jit, 0x48); // cmp rdx, len
+    emit8(jit, 0x81);
+    emit8(jit, 0xfa);
+    emit32(jit, len);
+    emit8(jit, 0x0f); // jb bail
+    emit8(jit, 0x82);
+    unsigned char* bail = jit->out;
+    emit32(jit, 0);
+    emit8(jit, 0x48); // sub rdx, len
+    emit8(jit, 0x81);
+    emit8(jit, 0xea);
+    emit32(jit, len);
+
+    for (int i = 0; i < len; ++i) {
+        const decodedType* d = &decoded[start + i];
+        switch (d->opcode) {
+            case ADD:
+            case NOR:
+                emitRegOp(jit, 0, 0x8b, 0, d->regA); // mov eax, reg[regA]
+                emitRegOp(jit, 0, d->opcode == ADD ? 0x03 : 0x0b, 0, d->regB); // add/or eax, reg[regB]
+                if (d->opcode == NOR) {
+                    emit8(jit, 0xf7); // not eax
+                    emit8(jit, 0xd0);
+                }
+                emitRegOp(jit, 0, 0x89, 0, d->dest); // mov reg[dest], eax
+                break;
+            case LW:
+            case SW:
+                emitRegOp(jit, 0, 0x8b, 0, d->regA); // mov eax, reg[regA]
+                if (d->offset != 0) {
+                    emit8(jit, 0x05); // add eax, offset
+                    emit32(jit, d->offset);
+                }
+                emit8(jit, 0x25); // and eax, NUMMEMORY - 1
+                emit32(jit, NUMMEMORY - 1);
+                emit8(jit, 0x41); // mov r9d, eax
+                emit8(jit, 0x89);
+                emit8(jit, 0xc1);
+                emit8(jit, 0x41); // shr r9d, log2(PAGEWORDS)
+                emit8(jit, 0xc1);
+                emit8(jit, 0xe9);
+                emit8(jit, __builtin_ctz(PAGEWORDS));
+                emit8(jit, 0x4e); // mov r9, dataPages[r9]
+                emit8(jit, 0x8b);
+                emit8(jit, 0x0c);
+                emit8(jit, 0xce);
+                emit8(jit, 0x25); // and eax, PAGEWORDS - 1
+                emit32(jit, PAGEWORDS - 1);
+                if (d->opcode == LW) {
+                    emit8(jit, 0x41); // mov eax, r9->words[rax]
+                    emit8(jit, 0x8b);
+                    emit8(jit, 0x44);
+                    emit8(jit, 0x81);
+                    emit8(jit, offsetof(pageType, words));
+                    emitRegOp(jit, 0, 0x89, 0, d->regB); // mov reg[regB], eax
+                } else {
+                    emit8(jit, 0x41); // cmp r9->refs, 1
+                    emit8(jit, 0x83);
+                    emit8(jit, 0x39);
+                    emit8(jit, 0x01);
+                    emit8(jit, 0x0f); // jne side exit
+                    emit8(jit, 0x85);
+                    sideExits[numSideExits].rel32 = jit->out;
+                    sideExits[numSideExits++].index = i;
+                    emit32(jit, 0);
+                    emitRegOp(jit, 0x44, 0x8b, 0, d->regB); // mov r8d, reg[regB]
+                    emit8(jit, 0x45); // mov r9->words[rax], r8d
+                    emit8(jit, 0x89);
+                    emit8(jit, 0x44);
+                    emit8(jit, 0x81);
+                    emit8(jit, offsetof(pageType, words));
+                }
+                break;
+            default:
+                // beq is handled below; jalr and everything else are noops
+                break;
+        }
+    }
+
+    int fallThrough = start + len;
+    if (endsInBranch) {
+        const decodedType* d = &decoded[start + len - 1];
+        emitRegOp(jit, 0, 0x8b, 0, d->regA); // mov eax, reg[regA]
+        emitRegOp(jit, 0, 0x3b, 0, d->regB); // cmp eax, reg[regB]
+        emit8(jit, 0x0f); // je taken
+        emit8(jit, 0x84);
+        unsigned char* taken = jit->out;
+        emit32(jit, 0);
+        emitExit(jit, fallThrough, self, start);
+        patchRel32(taken, jit->out);
+        emitExit(jit, fallThrough + d->offset, self, start);
+    } else {
+        emitExit(jit, fallThrough, self, start);
+    }
+
+    // these two must reach runJit, which interprets the next instruction
+    patchRel32(bail, jit->out);
+    emitReturn(jit, start);
+    for (int i = 0; i < numSideExits; ++i) {
+        patchRel32(sideExits[i].rel32, jit->out);
+        emit8(jit, 0x48); // add rdx, instructions not run
+        emit8(jit, 0x81);
+        emit8(jit, 0xc2);
+        emit32(jit, len - sideExits[i].index);
+        emitReturn(jit, start + sideExits[i].index);
+    }
+
+    jit->used = (size_t) (jit->out - jit->code);
+    jit->entry[start] = self;
+
+    // exits translated earlier that were waiting for this block now jump to it
+    for (int e = jit->pendingExits[start]; e >= 0; e = jit->exits[e].next) {
+        unsigned char* stub = jit->exits[e].stub;
+        jit->out = stub;
+        emit8(jit, 0xe9);
+        emit32(jit, 0);
+        patchRel32(stub + 1, self);
+    }
+    jit->pendingExits[start] = -1;
+    return self;
+}
+
+unsigned long long runJit(memoryType* mem, int* pcPtr, int* reg,
+        unsigned long long maxInstrs, int untilPc) {
+    jitType* jit = jitCreate(mem, untilPc);
+    if (jit == NULL) {
+        return runFunctional(mem, pcPtr, reg, maxInstrs, untilPc);
+    }
+    const decodedType* decoded = mem->decoded;
+    int pc = *pcPtr;
+    unsigned long long count = 0;
+
+    while (count < maxInstrs && pc != untilPc && pc >= 0 && pc < NUMMEMORY) {
+        if (decoded[pc].opcode == HALT) {
+            break;
+        }
+        unsigned char* block = jit->entry[pc];
+        if (block == NULL && jit->heat[pc] < JITTHRESHOLD && ++jit->heat[pc] == JITTHRESHOLD) {
+            block = translate(jit, pc);
+        }
+        if (block != NULL) {
+            unsigned long long left = maxInstrs - count;
+            long long budget = left > LLONG_MAX ? LLONG_MAX : (long long) left;
+            int nextPc;
+            long long remaining = ((blockFn) (void*) block)(reg, mem->dataPages, budget, &nextPc);
+            if (remaining != budget) {
+                count += (unsigned long long) (budget - remaining);
+                pc = nextPc;
+                continue;
+            }
+            // not enough budget for the block, or its first sw needs a page copied
+        }
+        count += runFunctional(mem, &pc, reg, 1, untilPc);
+    }
+    jitFree(jit);
+    *pcPtr = pc;
+    return count;
+}
+
+#else
+
+unsigned long long runJit(memoryType* mem, int* pcPtr, int* reg,
+        unsigned long long maxInstrs, int untilPc) {
+    return runFunctional(mem, pcPtr, reg, maxInstrs, untilPc);
+}
+
+#endif
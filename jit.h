@@ -0,0 +1,32 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Translation of LC-2K basic blocks to x86-64 for the functional model
+ *
+ * runJit has the same contract as runFunctional and gives the same
+ * results. Each block start is interpreted until it has been reached
+ * JITTHRESHOLD times. After that the straight-line run from there is
+ * translated to native code. A block ends after a beq or jalr, before a
+ * halt or untilPc, or after JITMAXBLOCK instructions. Translated blocks
+ * live in a code cache indexed by pc and jump straight to each other when
+ * the target is translated too. lw and sw walk the page table inline. A
+ * sw to a page that is still shared leaves native code before it, and the
+ * interpreter runs it and copies the page.
+ *
+ * sw only ever writes dataMem, and instructions are fetched from
+ * instrMem/decoded, so translated code can never go stale. The cache
+ * lives for a single call. On hosts other than x86-64, or if executable
+ * memory is not available, runJit just calls runFunctional.
+**/
+
+#ifndef JIT_H
+#define JIT_H
+
+#include "lc2k.h"
+
+#define JITTHRESHOLD 16
+#define JITMAXBLOCK 256
+
+unsigned long long runJit(memoryType* mem, int* pc, int* reg,
+    unsigned long long maxInstrs, int untilPc);
+
+#endif
@@ -0,0 +1,193 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Project 3: LC-2K Pipeline Simulator
+ * Printing and loading routines shared by the simulator and its tools.
+ * Make sure NOT to modify printState or any of the associated functions
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lc2k.h"
+
+const char* opcode_to_str_map[] = {
+    "add",
+    "nor",
+    "lw",
+    "sw",
+    "beq",
+    "jalr",
+    "halt",
+    "noop"
+};
+
+/*
+* DO NOT MODIFY ANY OF THE CODE BELOW.
+*/
+
+void fprintInstruction(FILE *out, int instr) {
+    const char* instr_opcode_str;
+    int instr_opcode = opcode(instr);
+    if(ADD <= instr_opcode && instr_opcode <= NOOP) {
+        instr_opcode_str = opcode_to_str_map[instr_opcode];
+    }
+
+    switch (instr_opcode) {
+        case ADD:
+        case NOR:
+        case LW:
+        case SW:
+        case BEQ:
+            fprintf(out, "%s %d %d %d", instr_opcode_str, field0(instr), field1(instr), convertNum(field2(instr)));
+            break;
+        case JALR:
+            fprintf(out, "%s %d %d", instr_opcode_str, field0(instr), field1(instr));
+            break;
+        case HALT:
+        case NOOP:
+            fprintf(out, "%s", instr_opcode_str);
+            break;
+        default:
+            fprintf(out, ".fill %d", instr);
+            return;
+    }
+}
+
+void fprintState(FILE *out, stateType *statePtr) {
+    fprintf(out, "\n@@@\n");
+    fprintf(out, "state before cycle %d starts:\n", statePtr->cycles);
+    fprintf(out, "\tpc = %d\n", statePtr->pc);
+
+    fprintf(out, "\tdata memory:\n");
+    for (int i=0; i<statePtr->mem->numMemory; ++i) {
+        fprintf(out, "\t\tdataMem[ %d ] = %d\n", i, loadWord(statePtr->mem, i));
+    }
+    fprintf(out, "\tregisters:\n");
+    for (int i=0; i<NUMREGS; ++i) {
+        fprintf(out, "\t\treg[ %d ] = %d\n", i, statePtr->reg[i]);
+    }
+
+    // IF/ID
+    fprintf(out, "\tIF/ID pipeline register:\n");
+    fprintf(out, "\t\tinstruction = %d ( ", statePtr->IFID.instr);
+    fprintInstruction(out, statePtr->IFID.instr);
+    fprintf(out, " )\n");
+    fprintf(out, "\t\tpcPlus1 = %d", statePtr->IFID.pcPlus1);
+    if(opcode(statePtr->IFID.instr) == NOOP){
+        fprintf(out, " (Don't Care)");
+    }
+    fprintf(out, "\n");
+
+    // ID/EX
+    int idexOp = opcode(statePtr->IDEX.instr);
+    fprintf(out, "\tID/EX pipeline register:\n");
+    fprintf(out, "\t\tinstruction = %d ( ", statePtr->IDEX.instr);
+    fprintInstruction(out, statePtr->IDEX.instr);
+    fprintf(out, " )\n");
+    fprintf(out, "\t\tpcPlus1 = %d", statePtr->IDEX.pcPlus1);
+    if(idexOp == NOOP){
+        fprintf(out, " (Don't Care)");
+    }
+    fprintf(out, "\n");
+    fprintf(out, "\t\treadRegA = %d", statePtr->IDEX.valA);
+    if (idexOp >= HALT || idexOp < 0) {
+        fprintf(out, " (Don't Care)");
+    }
+    fprintf(out, "\n");
+    fprintf(out, "\t\treadRegB = %d", statePtr->IDEX.valB);
+    if(idexOp == LW || idexOp > BEQ || idexOp < 0) {
+        fprintf(out, " (Don't Care)");
+    }
+    fprintf(out, "\n");
+    fprintf(out, "\t\toffset = %d", statePtr->IDEX.offset);
+    if (idexOp != LW && idexOp != SW && idexOp != BEQ) {
+        fprintf(out, " (Don't Care)");
+    }
+    fprintf(out, "\n");
+
+    // EX/MEM
+    int exmemOp = opcode(statePtr->EXMEM.instr);
+    fprintf(out, "\tEX/MEM pipeline register:\n");
+    fprintf(out, "\t\tinstruction = %d ( ", statePtr->EXMEM.instr);
+    fprintInstruction(out, statePtr->EXMEM.instr);
+    fprintf(out, " )\n");
+    fprintf(out, "\t\tbranchTarget %d", statePtr->EXMEM.branchTarget);
+    if (exmemOp != BEQ) {
+        fprintf(out, " (Don't Care)");
+    }
+    fprintf(out, "\n");
+    fprintf(out, "\t\teq ? %s", (statePtr->EXMEM.eq ? "True" : "False"));
+    if (exmemOp != BEQ) {
+        fprintf(out, " (Don't Care)");
+    }
+    fprintf(out, "\n");
+    fprintf(out, "\t\taluResult = %d", statePtr->EXMEM.aluResult);
+    if (exmemOp > SW || exmemOp < 0) {
+        fprintf(out, " (Don't Care)");
+    }
+    fprintf(out, "\n");
+    fprintf(out, "\t\treadRegB = %d", statePtr->EXMEM.valB);
+    if (exmemOp != SW) {
+        fprintf(out, " (Don't Care)");
+    }
+    fprintf(out, "\n");
+
+    // MEM/WB
+	int memwbOp = opcode(statePtr->MEMWB.instr);
+    fprintf(out, "\tMEM/WB pipeline register:\n");
+    fprintf(out, "\t\tinstruction = %d ( ", statePtr->MEMWB.instr);
+    fprintInstruction(out, statePtr->MEMWB.instr);
+    fprintf(out, " )\n");
+    fprintf(out, "\t\twriteData = %d", statePtr->MEMWB.writeData);
+    if (memwbOp >= SW || memwbOp < 0) {
+        fprintf(out, " (Don't Care)");
+    }
+    fprintf(out, "\n");
+
+    // WB/END
+	int wbendOp = opcode(statePtr->WBEND.instr);
+    fprintf(out, "\tWB/END pipeline register:\n");
+    fprintf(out, "\t\tinstruction = %d ( ", statePtr->WBEND.instr);
+    fprintInstruction(out, statePtr->WBEND.instr);
+    fprintf(out, " )\n");
+    fprintf(out, "\t\twriteData = %d", statePtr->WBEND.writeData);
+    if (wbendOp >= SW || wbendOp < 0) {
+        fprintf(out, " (Don't Care)");
+    }
+    fprintf(out, "\n");
+
+    fprintf(out, "end state\n");
+    fflush(out);
+}
+
+// One line of the load-time instruction memory listing
+void fprintInstrMemEntry(FILE *out, memoryType *mem, int addr) {
+    int instr = fetchWord(mem, addr);
+    fprintf(out, "\tinstrMem[ %d ]\t= 0x%08x\t= %d\t= ", addr, instr, instr);
+    fprintInstruction(out, instr);
+    fprintf(out, "\n");
+}
+
+// The lines printed once the machine halts, ending with the final state
+void fprintHalted(FILE *out, stateType *statePtr) {
+    fprintf(out, "Machine halted\n");
+    fprintf(out, "Total of %d cycles executed\n", statePtr->cycles);
+    fprintf(out, "Final state of machine:\n");
+    fprintState(out, statePtr);
+}
+
+void printInstruction(int instr) {
+    fprintInstruction(stdout, instr);
+}
+
+void printState(stateType *statePtr) {
+    fprintState(stdout, statePtr);
+}
+
+void printInstrMemEntry(memoryType *mem, int addr) {
+    fprintInstrMemEntry(stdout, mem, addr);
+}
+
+void printHalted(stateType *statePtr) {
+    fprintHalted(stdout, statePtr);
+}
@@ -0,0 +1,253 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * LC-2K machine definitions shared by the simulator and its tools
+**/
+
+#ifndef LC2K_H
+#define LC2K_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+// Machine Definitions
+#define NUMMEMORY 65536 // maximum number of data words in memory
+#define NUMREGS 8 // number of machine registers
+
+#define ADD 0
+#define NOR 1
+#define LW 2
+#define SW 3
+#define BEQ 4
+#define JALR 5 // will not implemented for Project 3
+#define HALT 6
+#define NOOP 7
+
+extern const char* opcode_to_str_map[];
+
+#define NOOPINSTR (NOOP << 22)
+#define NOOPINDEX NUMMEMORY // decoded[] slot holding the canonical noop bubble
+
+typedef enum {
+    noHaz,
+    EXMEM,
+    MEMWB,
+    WBEND
+} HazType;
+
+typedef struct IFIDStruct {
+	int pcPlus1;
+	int instr;
+	int instrIdx; // index of instr in mem->decoded
+	bool predTaken; // IF fetched the predicted target after this beq
+	int predIndex; // the counter IF predicted it with, which trains on it
+} IFIDType;
+
+typedef struct IDEXStruct {
+	int pcPlus1;
+	int valA;
+	int valB;
+	int offset;
+	int instr;
+	int instrIdx;
+    HazType valAhazType;
+    bool valAHaz;
+    bool valBHaz;
+    HazType valBhazType;
+	bool predTaken;
+	int predIndex;
+} IDEXType;
+
+typedef struct EXMEMStruct {
+	int branchTarget;
+    int eq;
+	int aluResult;
+	int valB;
+	int instr;
+	int instrIdx;
+    HazType valAhazType;
+    bool valAHaz;
+    bool valBHaz;
+    HazType valBhazType;
+	bool predTaken;
+	int predIndex;
+} EXMEMType;
+
+typedef struct MEMWBStruct {
+	int writeData;
+    int instr;
+    int instrIdx;
+    HazType valAhazType;
+    bool valAHaz;
+    bool valBHaz;
+    HazType valBhazType;
+} MEMWBType;
+
+typedef struct WBENDStruct {
+	int writeData;
+	int instr;
+	int instrIdx;
+    HazType valAhazType;
+    bool valAHaz;
+    bool valBHaz;
+    HazType valBhazType;
+} WBENDType;
+
+/* An instruction word split into its fields once, at load time, so the
+   pipeline stages never have to re-extract them. */
+typedef struct decodedStruct {
+	int instr; // raw word, kept for printing
+	int offset; // field2 sign-extended
+	short opcode; // instr>>22, which is outside 0..7 for some .fill words
+	unsigned short dest; // field2 as the add/nor destination register
+	unsigned char regA;
+	unsigned char regB;
+} decodedType;
+
+#define PAGEWORDS 1024 // 4 KB of words
+#define NUMPAGES (NUMMEMORY / PAGEWORDS)
+
+/* One page of instruction or data memory. Memories holding the same
+   program point at the same pages, and a page is copied the first time
+   it is written while anyone else can see it (refs != 1). zeroPage
+   stands in for every page that has never been written, so a lookup is
+   always two loads with no NULL check. */
+typedef struct pageStruct {
+	int refs; // memories pointing at this page; 0 for zeroPage
+	int words[PAGEWORDS];
+} pageType;
+
+extern pageType zeroPage;
+
+#define MAXLABEL 6 // characters in an assembly label
+
+/* A label from an assembly source and the address it names. */
+typedef struct symbolStruct {
+	char name[MAXLABEL + 1];
+	int addr;
+} symbolType;
+
+/* instrMem decoded, shared the same way as its pages. It is mapped
+   lazily and a zero word decodes to all zeros, so only the entries for
+   the program itself (and NOOPINDEX) ever become resident. */
+typedef struct codeStruct {
+	int refs;
+	symbolType* symbols; // labels by address if it was assembled, or NULL
+	int numSymbols;
+	decodedType decoded[NUMMEMORY + 1]; // plus NOOPINDEX
+} codeType;
+
+/* Instruction and data memory live outside the per-cycle state so that
+   advancing the pipeline never copies them. There is one of these per
+   machine and the MEM stage commits sw writes into it in place. Both
+   memories are page tables, and addresses wrap modulo NUMMEMORY. A
+   zeroed memoryType is empty; use memoryReset to let go of its pages. */
+typedef struct memoryStruct {
+	pageType* instrPages[NUMPAGES];
+	pageType* dataPages[NUMPAGES];
+	decodedType* decoded; // code->decoded
+	codeType* code;
+	unsigned int numMemory;
+} memoryType;
+
+/* Everything that changes from one cycle to the next. main keeps two of
+   these and swaps them by pointer at the end of each cycle. */
+typedef struct stateStruct {
+	int pc;
+	int reg[NUMREGS];
+	IFIDType IFID;
+	IDEXType IDEX;
+	EXMEMType EXMEM;
+	MEMWBType MEMWB;
+	WBENDType WBEND;
+	unsigned int cycles; // number of cycles run so far
+	memoryType* mem;
+} stateType;
+
+static inline int opcode(int instruction) {
+    return instruction>>22;
+}
+
+static inline int field0(int instruction) {
+    return (instruction>>19) & 0x7;
+}
+
+static inline int field1(int instruction) {
+    return (instruction>>16) & 0x7;
+}
+
+static inline int field2(int instruction) {
+    return instruction & 0xFFFF;
+}
+
+// convert a 16-bit number into a 32-bit Linux integer
+static inline int convertNum(int num) {
+    return num - ( (num & (1<<15)) ? 1<<16 : 0 );
+}
+
+static inline void decodeInstruction(int instr, decodedType* d) {
+    d->instr = instr;
+    d->opcode = opcode(instr);
+    d->regA = field0(instr);
+    d->regB = field1(instr);
+    d->dest = field2(instr);
+    d->offset = convertNum(field2(instr));
+}
+
+void printState(stateType*);
+void printInstruction(int);
+void printInstrMemEntry(memoryType*, int);
+void printHalted(stateType*);
+void fprintState(FILE*, stateType*);
+void fprintInstruction(FILE*, int);
+void fprintInstrMemEntry(FILE*, memoryType*, int);
+void fprintHalted(FILE*, stateType*);
+void decodeMemory(memoryType*);
+void memoryReset(memoryType*);
+void memoryShare(memoryType* dst, const memoryType* src);
+void memoryShareImage(memoryType*);
+void memoryShareData(memoryType* dst, const memoryType* src);
+pageType* privatePage(pageType** slot);
+const char* memoryLabel(const memoryType*, int addr);
+
+static inline int pageLoad(pageType* const* table, int addr) {
+    unsigned int a = (unsigned int) addr % NUMMEMORY;
+    return table[a / PAGEWORDS]->words[a % PAGEWORDS];
+}
+
+static inline void pageStore(pageType** table, int addr, int value) {
+    unsigned int a = (unsigned int) addr % NUMMEMORY;
+    pageType* page = table[a / PAGEWORDS];
+    if (page->refs != 1) {
+        page = privatePage(&table[a / PAGEWORDS]);
+    }
+    page->words[a % PAGEWORDS] = value;
+}
+
+// dataMem[addr], as lw sees it. This and storeWord are on the lw/sw
+// paths, so they do the lookup themselves rather than call pageLoad.
+static inline int loadWord(const memoryType* mem, int addr) {
+    unsigned int a = (unsigned int) addr % NUMMEMORY;
+    return mem->dataPages[a / PAGEWORDS]->words[a % PAGEWORDS];
+}
+
+// dataMem[addr] = value, as sw does it
+static inline void storeWord(memoryType* mem, int addr, int value) {
+    unsigned int a = (unsigned int) addr % NUMMEMORY;
+    pageType* page = mem->dataPages[a / PAGEWORDS];
+    if (page->refs != 1) {
+        page = privatePage(&mem->dataPages[a / PAGEWORDS]);
+    }
+    page->words[a % PAGEWORDS] = value;
+}
+
+// instrMem[addr]; the pipeline reads decoded[addr].instr instead
+static inline int fetchWord(const memoryType* mem, int addr) {
+    return pageLoad(mem->instrPages, addr);
+}
+
+// instrMem[addr] = value, for loaders
+static inline void storeInstr(memoryType* mem, int addr, int value) {
+    pageStore(mem->instrPages, addr, value);
+}
+
+#endif
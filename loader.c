@@ -0,0 +1,208 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Loading programs into instruction and data memory, see loader.h
+ *
+ * The whole file is mapped and parsed in place. Text is parsed with a
+ * small hand-written integer scanner that follows sscanf("%d") on each
+ * line (leading blanks, optional sign, digits, anything after ignored),
+ * so it accepts and rejects exactly what the fgets/sscanf loader did.
+**/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "loader.h"
+#include "assemble.h"
+
+#define MCB_HEADERBYTES 16
+
+void readMachineCode(memoryType *mem, char* filename) {
+    if (loadMachineCode(mem, filename, stdout, true) != 0) {
+        exit(1);
+    }
+}
+
+static inline uint32_t getLE32(const unsigned char* p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static inline bool isLineSpace(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/* Parses one word per line into instrMem. Returns the address of the
+   first bad line, or -1 if every line held a number. */
+static int parseText(memoryType *mem, const unsigned char* p, const unsigned char* end) {
+    unsigned int n = 0;
+    while (p < end) {
+        if (n >= NUMMEMORY) {
+            return (int) n;
+        }
+        while (p < end && isLineSpace(*p)) {
+            ++p;
+        }
+        unsigned int negative = 0;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative = *p == '-';
+            ++p;
+        }
+        const unsigned char* digits = p;
+        unsigned int value = 0;
+        unsigned int d;
+        while (p < end && (d = (unsigned int) *p - '0') < 10) {
+            value = value * 10 + d;
+            ++p;
+        }
+        if (p == digits) {
+            return (int) n;
+        }
+        storeInstr(mem, (int) n++, (int) ((value ^ (0u - negative)) + negative));
+
+        const unsigned char* newline = memchr(p, '\n', (size_t) (end - p));
+        p = newline != NULL ? newline + 1 : end;
+    }
+    mem->numMemory = n;
+    return -1;
+}
+
+/* Copies a .mcb image into instrMem. Returns -1 on success, otherwise the
+   number of words that were read before the file ran out. */
+static int parseBinary(memoryType *mem, const unsigned char* p, size_t size) {
+    uint32_t count = getLE32(p + 12);
+    size_t avail = (size - MCB_HEADERBYTES) / 4;
+    if (count > NUMMEMORY || count > avail) {
+        return (int) (avail < NUMMEMORY ? avail : NUMMEMORY);
+    }
+    p += MCB_HEADERBYTES;
+    for (uint32_t i = 0; i < count; ++i) {
+        storeInstr(mem, (int) i, (int) getLE32(p + 4 * i));
+    }
+    mem->numMemory = count;
+    return -1;
+}
+
+/* Whether filename ends in one of the assembly source suffixes the
+   Makefile assembles. */
+static bool isAssembly(const char* filename) {
+    static const char* const suffixes[] = {".as", ".s", ".lc2k"};
+    size_t len = strlen(filename);
+    for (int i = 0; i < (int) (sizeof(suffixes) / sizeof(suffixes[0])); ++i) {
+        size_t n = strlen(suffixes[i]);
+        if (len > n && !strcmp(filename + len - n, suffixes[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Loads a .mc, .mcb or assembly file and, if listing is set, prints the instruction
+   memory listing to out. On error, prints the same message the simulator
+   always has to out and returns -1 instead of exiting. */
+int loadMachineCode(memoryType *mem, const char* filename, FILE *out, bool listing) {
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(out, "error: can't open file %s", filename);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    size_t size = (size_t) st.st_size;
+    const unsigned char* base = NULL;
+    void* mapped = MAP_FAILED;
+    if (size > 0) {
+        mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            fprintf(out, "error: can't open file %s", filename);
+            close(fd);
+            return -1;
+        }
+        base = mapped;
+    }
+    close(fd);
+
+    // memory may hold a previous program (see batch.c)
+    memoryReset(mem);
+
+    int bad;
+    symbolType* symbols = NULL;
+    int numSymbols = 0;
+    if (isAssembly(filename)) {
+        if (assembleProgram(mem, filename, (const char*) base, size, out, &symbols, &numSymbols) != 0) {
+            if (mapped != MAP_FAILED) {
+                munmap(mapped, size);
+            }
+            return -1;
+        }
+        bad = -1;
+    } else if (size >= MCB_HEADERBYTES && !memcmp(base, MCB_MAGIC, sizeof(MCB_MAGIC))) {
+        if (getLE32(base + 8) != MCB_VERSION) {
+            fprintf(out, "error: %s has unsupported .mcb version %u\n", filename, getLE32(base + 8));
+            munmap(mapped, size);
+            return -1;
+        }
+        bad = parseBinary(mem, base, size);
+    } else {
+        bad = parseText(mem, base, base + size);
+    }
+    if (mapped != MAP_FAILED) {
+        munmap(mapped, size);
+    }
+
+    // the listing runs up to the first bad word, as it always has
+    int good = bad < 0 ? (int) mem->numMemory : bad;
+    if (listing) {
+        fprintf(out, "instruction memory:\n");
+        for (int i = 0; i < good; ++i) {
+            fprintInstrMemEntry(out, mem, i);
+        }
+    }
+    if (bad >= 0) {
+        fprintf(out, "error in reading address %d\n", bad);
+        return -1;
+    }
+    memoryShareImage(mem);
+
+    decodeMemory(mem);
+    mem->code->symbols = symbols;
+    mem->code->numSymbols = numSymbols;
+    return 0;
+}
+
+/* Writes the loaded program as a .mcb file. */
+void saveMachineCodeBinary(memoryType *mem, const char* filename) {
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) {
+        printf("error: can't open file %s\n", filename);
+        exit(1);
+    }
+    unsigned char header[MCB_HEADERBYTES];
+    memcpy(header, MCB_MAGIC, sizeof(MCB_MAGIC));
+    unsigned int fields[2] = {MCB_VERSION, mem->numMemory};
+    for (int f = 0; f < 2; ++f) {
+        for (int i = 0; i < 4; ++i) {
+            header[8 + 4 * f + i] = (unsigned char) (fields[f] >> (8 * i));
+        }
+    }
+    fwrite(header, 1, sizeof(header), file);
+    for (unsigned int w = 0; w < mem->numMemory; ++w) {
+        unsigned char bytes[4];
+        for (int i = 0; i < 4; ++i) {
+            bytes[i] = (unsigned char) ((unsigned int) fetchWord(mem, (int) w) >> (8 * i));
+        }
+        fwrite(bytes, 1, 4, file);
+    }
+    if (fclose(file) != 0) {
+        printf("error: failed writing %s\n", filename);
+        exit(1);
+    }
+}
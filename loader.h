@@ -0,0 +1,28 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Loading programs into instruction and data memory
+ *
+ * Three formats are accepted. A .mc file is text with one decimal word per
+ * line, as written by the assembler. A .mcb file is the same program in
+ * binary: an MCB_MAGIC header, a little-endian u32 version and word count,
+ * then that many little-endian 32-bit words. The loader tells those two
+ * apart by the magic, not the file name. A file named .as, .s or .lc2k is
+ * assembly source, which is assembled in-process (see assemble.h).
+**/
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "lc2k.h"
+
+#define MCB_MAGIC "LC2KMCB" // 8 bytes including the terminating NUL
+#define MCB_VERSION 1
+
+void readMachineCode(memoryType*, char*);
+int loadMachineCode(memoryType*, const char*, FILE*, bool listing);
+void saveMachineCodeBinary(memoryType*, const char*);
+
+#endif
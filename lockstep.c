@@ -0,0 +1,440 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Lockstep functional runs of one program over many data images, see
+ * lockstep.h
+ *
+ * Lane vectors use GCC's vector extension, which compiles to SSE2 by
+ * default and to AVX2 when built with -mavx2.
+**/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "lockstep.h"
+#include "lc2k.h"
+#include "loader.h"
+#include "filelist.h"
+
+typedef int laneVec __attribute__((vector_size(LOCKSTEPLANES * sizeof(int))));
+
+#define ALLLANES ((1u << LOCKSTEPLANES) - 1)
+#define COUNTFOLD (1u << 30) // steps between folding the 32-bit lane counts
+
+typedef enum {
+    laneHalted,
+    laneOffEnd, // pc left memory
+    laneBadAddress, // lw/sw outside memory
+    laneBadRegister // add/nor destination above the last register
+} laneStatus;
+
+static const char* laneStatusText[] = {
+    "halted", "ran off the end of memory", "faulted on a memory address", "faulted on a register number"
+};
+
+typedef struct imageStruct {
+    char* path;
+    int* addrs; // words this image overwrites
+    int* values;
+    int numWords;
+} imageType;
+
+typedef struct groupStruct {
+    laneVec reg[NUMREGS];
+    laneVec pc; // stale for running lanes while they are all at the same pc
+    laneVec* dataMem; // NUMMEMORY rows of one word per lane
+    laneVec* initial; // the rows as they were before the run
+    int usedRows; // rows past this are zero in every lane
+    int initialRows;
+    unsigned int running; // one bit per lane
+    laneVec runningMask;
+    laneStatus status[LOCKSTEPLANES];
+    unsigned long long instrs[LOCKSTEPLANES];
+    laneVec pendingInstrs; // not yet added to instrs
+    unsigned int pendingSteps;
+} groupType;
+
+/* Lane vectors are never passed by value: without -mavx GCC warns that
+   doing so has a different ABI. */
+#define SPLAT(x) ((laneVec) {0} + (x))
+#define BLEND(mask, a, b) (((a) & (mask)) | ((b) & ~(mask))) // a where mask is set
+
+static inline void setMask(laneVec* m, unsigned int bits) {
+    for (int l = 0; l < LOCKSTEPLANES; ++l) {
+        (*m)[l] = (bits >> l) & 1 ? -1 : 0;
+    }
+}
+
+static inline bool anyLane(const laneVec* m) {
+    unsigned long long words[sizeof(laneVec) / sizeof(unsigned long long)];
+    memcpy(words, m, sizeof(words));
+    unsigned long long any = 0;
+    for (int i = 0; i < (int) (sizeof(words) / sizeof(words[0])); ++i) {
+        any |= words[i];
+    }
+    return any != 0;
+}
+
+static inline unsigned int bitsOf(const laneVec* m) {
+    unsigned int bits = 0;
+    for (int l = 0; l < LOCKSTEPLANES; ++l) {
+        bits |= (unsigned int) ((*m)[l] & 1) << l;
+    }
+    return bits;
+}
+
+/* ------------------------------ images ------------------------------ */
+
+static void readImage(imageType* image) {
+    FILE* file = fopen(image->path, "r");
+    if (file == NULL) {
+        printf("error: can't open data image %s\n", image->path);
+        exit(1);
+    }
+    int maxWords = 0;
+    char line[256];
+    for (int lineNum = 1; fgets(line, sizeof(line), file) != NULL; ++lineNum) {
+        char* text = line + strspn(line, " \t");
+        if (*text == '\0' || *text == '\n' || *text == '\r' || *text == '#') {
+            continue;
+        }
+        int addr, value;
+        char extra;
+        if (sscanf(text, "%d %d %c", &addr, &value, &extra) != 2) {
+            printf("error: %s line %d: expected \"address value\"\n", image->path, lineNum);
+            exit(1);
+        }
+        if (addr < 0 || addr >= NUMMEMORY) {
+            printf("error: %s line %d: address %d out of range\n", image->path, lineNum, addr);
+            exit(1);
+        }
+        if (image->numWords == maxWords) {
+            maxWords = maxWords ? maxWords * 2 : 16;
+            image->addrs = realloc(image->addrs, maxWords * sizeof(int));
+            image->values = realloc(image->values, maxWords * sizeof(int));
+            if (image->addrs == NULL || image->values == NULL) {
+                printf("error: out of memory for data images\n");
+                exit(1);
+            }
+        }
+        image->addrs[image->numWords] = addr;
+        image->values[image->numWords++] = value;
+    }
+    fclose(file);
+}
+
+static void addImage(imageType** images, int* numImages, int* capacity, const char* path) {
+    if (*numImages == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        *images = realloc(*images, *capacity * sizeof(imageType));
+        if (*images == NULL) {
+            printf("error: out of memory for data images\n");
+            exit(1);
+        }
+    }
+    imageType* image = &(*images)[(*numImages)++];
+    memset(image, 0, sizeof(*image));
+    image->path = strdup(path);
+    if (image->path == NULL) {
+        printf("error: out of memory for data images\n");
+        exit(1);
+    }
+    readImage(image);
+}
+
+/* source is either a directory, whose *.data files are all used, or a text
+   file listing one image path per line. */
+static imageType* findImages(const char* source, int* numImages) {
+    imageType* images = NULL;
+    int capacity = 0;
+    *numImages = 0;
+    int numPaths;
+    char** paths = fileListCreate(source, ".data", &numPaths);
+    for (int i = 0; i < numPaths; ++i) {
+        addImage(&images, numImages, &capacity, paths[i]);
+    }
+    fileListFree(paths, numPaths);
+    return images;
+}
+
+/* ------------------------------- lanes ------------------------------ */
+
+/* Loads the program's memory into every lane, then each image over its
+   own lane. Lanes without an image do not run. */
+static void groupInit(groupType* g, const memoryType* mem, const imageType* images, int numLanes) {
+    int rows = g->usedRows > mem->numMemory ? g->usedRows : mem->numMemory;
+    for (int r = 0; r < rows; ++r) {
+        g->dataMem[r] = SPLAT(r < mem->numMemory ? loadWord(mem, r) : 0);
+    }
+    g->usedRows = mem->numMemory;
+    for (int l = 0; l < numLanes; ++l) {
+        for (int i = 0; i < images[l].numWords; ++i) {
+            int addr = images[l].addrs[i];
+            g->dataMem[addr][l] = images[l].values[i];
+            if (addr >= g->usedRows) {
+                g->usedRows = addr + 1;
+            }
+        }
+    }
+    g->initialRows = g->usedRows;
+    memcpy(g->initial, g->dataMem, g->usedRows * sizeof(laneVec));
+
+    for (int r = 0; r < NUMREGS; ++r) {
+        g->reg[r] = SPLAT(0);
+    }
+    g->pc = SPLAT(0);
+    g->running = ALLLANES >> (LOCKSTEPLANES - numLanes);
+    setMask(&g->runningMask, g->running);
+    memset(g->instrs, 0, sizeof(g->instrs));
+    g->pendingInstrs = SPLAT(0);
+    g->pendingSteps = 0;
+}
+
+static inline void foldInstrs(groupType* g) {
+    for (int l = 0; l < LOCKSTEPLANES; ++l) {
+        g->instrs[l] += (unsigned int) g->pendingInstrs[l];
+    }
+    g->pendingInstrs = SPLAT(0);
+    g->pendingSteps = 0;
+}
+
+static inline void countStep(groupType* g, const laneVec* m) {
+    g->pendingInstrs -= *m;
+    if (++g->pendingSteps == COUNTFOLD) {
+        foldInstrs(g);
+    }
+}
+
+/* Stops the lanes in bits, which are all at pc. */
+static inline void stopLanes(groupType* g, unsigned int bits, int pc, laneStatus status) {
+    for (int l = 0; l < LOCKSTEPLANES; ++l) {
+        if ((bits >> l) & 1) {
+            g->status[l] = status;
+            g->pc[l] = pc;
+        }
+    }
+    g->running &= ~bits;
+    setMask(&g->runningMask, g->running);
+}
+
+/* The lowest pc of any running lane, and whether they are all there. */
+static inline int lowestPc(const groupType* g, bool* together) {
+    laneVec pcs = BLEND(g->runningMask, g->pc, SPLAT(INT_MAX));
+    int lowest = INT_MAX;
+    for (int l = 0; l < LOCKSTEPLANES; ++l) {
+        lowest = pcs[l] < lowest ? pcs[l] : lowest;
+    }
+    laneVec elsewhere = (pcs != SPLAT(lowest)) & g->runningMask;
+    *together = !anyLane(&elsewhere);
+    return lowest;
+}
+
+/* Runs a lw or sw for the lanes in *m. Lanes whose address is outside
+   memory are stopped first and taken out of *m. */
+static inline void runMemory(groupType* g, const decodedType* d, laneVec* mPtr, int pc) {
+    laneVec m = *mPtr;
+    laneVec addr = g->reg[d->regA] + d->offset;
+    unsigned int bits = bitsOf(&m);
+    unsigned int bad = 0;
+    bool same = true;
+    int addr0 = addr[__builtin_ctz(bits)];
+    for (int l = 0; l < LOCKSTEPLANES; ++l) {
+        if ((bits >> l) & 1) {
+            if (addr[l] < 0 || addr[l] >= NUMMEMORY) {
+                bad |= 1u << l;
+            } else if (addr[l] != addr0) {
+                same = false;
+            }
+        }
+    }
+    if (bad) {
+        same = false; // addr0 may be one of them
+        stopLanes(g, bad, pc, laneBadAddress);
+        bits &= ~bad;
+        setMask(&m, bits);
+        *mPtr = m;
+        if (bits == 0) {
+            return;
+        }
+    }
+
+    if (same) {
+        // one row holds every lane's copy of the word
+        laneVec* row = &g->dataMem[addr0];
+        if (d->opcode == LW) {
+            g->reg[d->regB] = BLEND(m, *row, g->reg[d->regB]);
+        } else {
+            *row = BLEND(m, g->reg[d->regB], *row);
+            if (addr0 >= g->usedRows) {
+                g->usedRows = addr0 + 1;
+            }
+        }
+        return;
+    }
+
+    for (int l = 0; l < LOCKSTEPLANES; ++l) {
+        if ((bits >> l) & 1) {
+            if (d->opcode == LW) {
+                g->reg[d->regB][l] = g->dataMem[addr[l]][l];
+            } else {
+                g->dataMem[addr[l]][l] = g->reg[d->regB][l];
+                if (addr[l] >= g->usedRows) {
+                    g->usedRows = addr[l] + 1;
+                }
+            }
+        }
+    }
+}
+
+/* Runs the group until every lane has stopped and returns the number of
+   steps taken. */
+static unsigned long long runGroup(groupType* group, const memoryType* mem) {
+    // work on a copy the compiler can keep in registers; dataMem can't alias it
+    groupType lanes = *group;
+    groupType* g = &lanes;
+    const decodedType* decoded = mem->decoded;
+    unsigned long long steps = 0;
+    int pc = 0;
+    bool together = true; // all running lanes are at pc, and g->pc is stale
+
+    while (g->running) {
+        if (!together) {
+            pc = lowestPc(g, &together);
+        }
+        laneVec m = together ? g->runningMask : (g->pc == SPLAT(pc)) & g->runningMask;
+        if (pc < 0 || pc >= NUMMEMORY) {
+            stopLanes(g, bitsOf(&m), pc, laneOffEnd);
+            continue;
+        }
+        const decodedType* d = &decoded[pc];
+        int nextPc = pc + 1;
+
+        switch (d->opcode) {
+            case HALT:
+                stopLanes(g, bitsOf(&m), pc, laneHalted);
+                continue;
+            case ADD:
+            case NOR:
+                if (d->dest >= NUMREGS) {
+                    stopLanes(g, bitsOf(&m), pc, laneBadRegister);
+                    continue;
+                }
+                if (d->opcode == ADD) {
+                    g->reg[d->dest] = BLEND(m, g->reg[d->regA] + g->reg[d->regB], g->reg[d->dest]);
+                } else {
+                    g->reg[d->dest] = BLEND(m, ~(g->reg[d->regA] | g->reg[d->regB]), g->reg[d->dest]);
+                }
+                break;
+            case LW:
+            case SW:
+                runMemory(g, d, &m, pc);
+                break;
+            case BEQ: {
+                laneVec equal = (g->reg[d->regA] == g->reg[d->regB]) & m;
+                laneVec notTaken = m & ~equal;
+                if (!anyLane(&notTaken)) {
+                    nextPc += d->offset;
+                } else if (anyLane(&equal)) {
+                    // the lanes at pc split up
+                    laneVec next = SPLAT(nextPc) + (equal & d->offset);
+                    g->pc = BLEND(m, next, g->pc);
+                    countStep(g, &m);
+                    ++steps;
+                    together = false;
+                    continue;
+                }
+                break;
+            }
+            default:
+                // jalr and unknown opcodes are noops
+                break;
+        }
+
+        countStep(g, &m);
+        ++steps;
+        if (together) {
+            pc = nextPc;
+        } else {
+            g->pc = BLEND(m, SPLAT(nextPc), g->pc);
+        }
+    }
+    foldInstrs(g);
+    *group = lanes;
+    return steps;
+}
+
+static void printLane(const groupType* g, int l, const imageType* image) {
+    printf("%s: %s at pc %d after %llu instructions\n", image->path,
+        laneStatusText[g->status[l]], g->pc[l], g->instrs[l]);
+    printf("\tregisters:");
+    for (int r = 0; r < NUMREGS; ++r) {
+        printf(" %d", g->reg[r][l]);
+    }
+    printf("\n");
+    for (int r = 0; r < g->usedRows; ++r) {
+        int before = r < g->initialRows ? g->initial[r][l] : 0;
+        if (g->dataMem[r][l] != before) {
+            printf("\tdataMem[ %d ] %d\n", r, g->dataMem[r][l]);
+        }
+    }
+}
+
+/* ------------------------------ driver ------------------------------ */
+
+/* Runs program once per data image named by images and prints each
+   image's final state. Returns 0 if every image halted. */
+int runLockstep(const char* program, const char* images) {
+    static memoryType mem;
+    if (loadMachineCode(&mem, program, stdout, false) != 0) {
+        return 1;
+    }
+    int numImages;
+    imageType* image = findImages(images, &numImages);
+
+    // lane vectors need their natural alignment, which malloc doesn't promise
+    void* group = NULL;
+    void* rows[2] = {NULL, NULL};
+    if (posix_memalign(&group, sizeof(laneVec), sizeof(groupType)) != 0
+            || posix_memalign(&rows[0], sizeof(laneVec), NUMMEMORY * sizeof(laneVec)) != 0
+            || posix_memalign(&rows[1], sizeof(laneVec), NUMMEMORY * sizeof(laneVec)) != 0) {
+        printf("error: out of memory for lockstep lanes\n");
+        exit(1);
+    }
+    groupType* g = group;
+    memset(g, 0, sizeof(*g));
+    g->dataMem = rows[0];
+    g->initial = rows[1];
+    memset(g->dataMem, 0, NUMMEMORY * sizeof(laneVec));
+
+    unsigned long long steps = 0;
+    unsigned long long instrs = 0;
+    int halted = 0;
+    for (int first = 0; first < numImages; first += LOCKSTEPLANES) {
+        int numLanes = numImages - first < LOCKSTEPLANES ? numImages - first : LOCKSTEPLANES;
+        groupInit(g, &mem, &image[first], numLanes);
+        steps += runGroup(g, &mem);
+        for (int l = 0; l < numLanes; ++l) {
+            printLane(g, l, &image[first + l]);
+            instrs += g->instrs[l];
+            halted += g->status[l] == laneHalted;
+        }
+    }
+    int groups = (numImages + LOCKSTEPLANES - 1) / LOCKSTEPLANES;
+    printf("%d images in %d groups of %d lanes: %llu instructions in %llu steps (%.1f%% of lane slots used)\n",
+        numImages, groups, LOCKSTEPLANES, instrs, steps,
+        steps > 0 ? 100.0 * instrs / ((double) steps * LOCKSTEPLANES) : 0.0);
+
+    for (int i = 0; i < numImages; ++i) {
+        free(image[i].path);
+        free(image[i].addrs);
+        free(image[i].values);
+    }
+    free(image);
+    free(rows[0]);
+    free(rows[1]);
+    free(g);
+    return halted == numImages ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Lockstep functional runs of one program over many data images
+ *
+ * A data image is a text file of "address value" lines (blank lines and
+ * lines starting with # are skipped) that overwrite words of the loaded
+ * program's memory. Images are run LOCKSTEPLANES at a time as the lanes of
+ * one group. Registers, pcs and memory are kept as structure-of-arrays: one
+ * vector per register and per memory word, with one element per lane, so
+ * add, nor, beq and same-address lw/sw are a few vector operations for the
+ * whole group.
+ *
+ * Each step runs the instruction at the lowest pc any running lane is at,
+ * masked to the lanes that are there. Lanes that went different ways at a
+ * beq therefore take turns, and run together again as soon as the trailing
+ * ones catch up. Like runFunctional, jalr and unknown opcodes are noops. A
+ * lane stops at halt, when its pc leaves memory, or at a lw/sw whose address
+ * is outside memory or an add/nor whose destination is not a register.
+**/
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#define LOCKSTEPLANES 8
+
+int runLockstep(const char* program, const char* images);
+
+#endif
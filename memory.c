@@ -0,0 +1,143 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Paged, copy-on-write instruction and data memory, see memoryType in lc2k.h
+**/
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "lc2k.h"
+
+pageType zeroPage;
+
+static void releasePage(pageType* page) {
+    if (page != NULL && page != &zeroPage && --page->refs == 0) {
+        free(page);
+    }
+}
+
+static pageType* sharePage(pageType* page) {
+    if (page != &zeroPage) {
+        ++page->refs;
+    }
+    return page;
+}
+
+/* Replaces *slot with a copy that only its owner can see, the first time
+   a shared page or zeroPage is written. */
+pageType* privatePage(pageType** slot) {
+    pageType* page = malloc(sizeof(pageType));
+    if (page == NULL) {
+        printf("error: out of memory for a memory page\n");
+        exit(1);
+    }
+    page->refs = 1;
+    memcpy(page->words, (*slot)->words, sizeof(page->words));
+    releasePage(*slot);
+    *slot = page;
+    return page;
+}
+
+static void releaseCode(codeType* code) {
+    if (code != NULL && --code->refs == 0) {
+        free(code->symbols);
+        munmap(code, sizeof(codeType));
+    }
+}
+
+/* Lets go of every page and the decoded program, leaving all of memory
+   zero and nothing decoded. */
+void memoryReset(memoryType* mem) {
+    for (int i = 0; i < NUMPAGES; ++i) {
+        releasePage(mem->instrPages[i]);
+        releasePage(mem->dataPages[i]);
+        mem->instrPages[i] = mem->dataPages[i] = &zeroPage;
+    }
+    releaseCode(mem->code);
+    mem->code = NULL;
+    mem->decoded = NULL;
+    mem->numMemory = 0;
+}
+
+/* Makes dst a copy of src that shares all of its pages and its decoded
+   program until either of them writes. */
+void memoryShare(memoryType* dst, const memoryType* src) {
+    memoryReset(dst);
+    for (int i = 0; i < NUMPAGES; ++i) {
+        dst->instrPages[i] = sharePage(src->instrPages[i]);
+        dst->dataPages[i] = sharePage(src->dataPages[i]);
+    }
+    dst->code = src->code;
+    dst->decoded = src->decoded;
+    if (dst->code != NULL) {
+        ++dst->code->refs;
+    }
+    dst->numMemory = src->numMemory;
+}
+
+/* Starts dataMem off as instrMem. They share pages until sw writes one. */
+void memoryShareImage(memoryType* mem) {
+    for (int i = 0; i < NUMPAGES; ++i) {
+        releasePage(mem->dataPages[i]);
+        mem->dataPages[i] = sharePage(mem->instrPages[i]);
+    }
+}
+
+/* Points dst's dataMem at src's pages, leaving its instrMem alone. */
+void memoryShareData(memoryType* dst, const memoryType* src) {
+    for (int i = 0; i < NUMPAGES; ++i) {
+        releasePage(dst->dataPages[i]);
+        dst->dataPages[i] = sharePage(src->dataPages[i]);
+    }
+}
+
+// Decode instrMem once so the stages never re-extract fields. Words on
+// pages that were never written stay zero, which is what they decode to.
+void decodeMemory(memoryType *mem) {
+    releaseCode(mem->code);
+    codeType* code = mmap(NULL, sizeof(codeType), PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        printf("error: out of memory for the decoded program\n");
+        exit(1);
+    }
+    code->refs = 1;
+    for (int page = 0; page < NUMPAGES; ++page) {
+        if (mem->instrPages[page] == &zeroPage) {
+            continue;
+        }
+        const int* words = mem->instrPages[page]->words;
+        for (int i = 0; i < PAGEWORDS; ++i) {
+            if (words[i] != 0) {
+                decodeInstruction(words[i], &code->decoded[page * PAGEWORDS + i]);
+            }
+        }
+    }
+    decodeInstruction(NOOPINSTR, &code->decoded[NOOPINDEX]);
+    mem->code = code;
+    mem->decoded = code->decoded;
+}
+
+/* The label at addr in an assembled program, or NULL. */
+const char* memoryLabel(const memoryType* mem, int addr) {
+    if (mem->code == NULL) {
+        return NULL;
+    }
+    const symbolType* symbols = mem->code->symbols;
+    int lo = 0;
+    int hi = mem->code->numSymbols - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (symbols[mid].addr == addr) {
+            return symbols[mid].name;
+        } else if (symbols[mid].addr < addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return NULL;
+}
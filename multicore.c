@@ -0,0 +1,244 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Several five-stage pipelines sharing one data memory, see multicore.h
+ *
+ * Every core's dataPages point at the same pages, which are made private
+ * to the cores before the run so that a sw never has to copy one. Held
+ * stores are written into those pages directly, the one place a page
+ * with refs != 1 is written.
+ *
+ * With -j N, cores are dealt round-robin to N threads. Each cycle, the
+ * first thread commits the last cycle's stores and charges the caches
+ * while the others wait at a barrier, and then every thread runs the
+ * cycle for its own cores up to a second barrier.
+**/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "multicore.h"
+#include "lc2k.h"
+#include "pipeline.h"
+#include "loader.h"
+
+typedef struct coreStruct {
+    memoryType mem;
+    pipelineType pipeline;
+    bool halted;
+    unsigned long long retired; // non-bubble instructions through WB
+    unsigned long long frozen; // cycles waiting on a cache miss
+    char icacheName[32];
+    char dcacheName[32];
+} coreType;
+
+typedef struct multicoreStruct {
+    coreType* cores;
+    int numCores;
+    int numThreads;
+    pthread_barrier_t barrier;
+    bool running; // set by the first thread before each cycle
+} multicoreType;
+
+typedef struct threadStruct {
+    multicoreType* mc;
+    int id;
+    pthread_t thread;
+} threadType;
+
+/* Commits the stores held last cycle and charges this cycle's cache
+   accesses, both in core order. Returns whether any core still runs. */
+static bool startCycle(multicoreType* mc) {
+    pageType** dataPages = mc->cores[0].mem.dataPages;
+    bool running = false;
+    for (int c = 0; c < mc->numCores; ++c) {
+        coreType* core = &mc->cores[c];
+        pipelineType* p = &core->pipeline;
+        if (p->storeHeld) {
+            unsigned int a = (unsigned int) p->heldAddr % NUMMEMORY;
+            dataPages[a / PAGEWORDS]->words[a % PAGEWORDS] = p->heldValue;
+            p->storeHeld = false;
+        }
+        if (core->halted || (core->halted = pipelineHalted(p))) {
+            continue;
+        }
+        if (p->icache != NULL || p->dcache != NULL) {
+            pipelineChargeCaches(p);
+        }
+        running = true;
+    }
+    return running;
+}
+
+static void coreCycle(coreType* core) {
+    pipelineType* p = &core->pipeline;
+    const stateType* before = p->state;
+    pipelineCycle(p);
+    if (p->state == before) {
+        core->frozen++;
+    } else if (p->state->WBEND.instrIdx != NOOPINDEX) {
+        core->retired++;
+    }
+}
+
+static void* coreThread(void* arg) {
+    threadType* t = arg;
+    multicoreType* mc = t->mc;
+    while (true) {
+        if (t->id == 0) {
+            mc->running = startCycle(mc);
+        }
+        pthread_barrier_wait(&mc->barrier);
+        if (!mc->running) {
+            return NULL;
+        }
+        for (int c = t->id; c < mc->numCores; c += mc->numThreads) {
+            if (!mc->cores[c].halted) {
+                coreCycle(&mc->cores[c]);
+            }
+        }
+        pthread_barrier_wait(&mc->barrier);
+    }
+}
+
+static void run(multicoreType* mc) {
+    if (mc->numThreads == 1) {
+        while (startCycle(mc)) {
+            for (int c = 0; c < mc->numCores; ++c) {
+                if (!mc->cores[c].halted) {
+                    coreCycle(&mc->cores[c]);
+                }
+            }
+        }
+        return;
+    }
+    threadType* threads = calloc(mc->numThreads, sizeof(threadType));
+    if (threads == NULL || pthread_barrier_init(&mc->barrier, NULL, mc->numThreads) != 0) {
+        printf("error: out of memory for core threads\n");
+        exit(1);
+    }
+    for (int i = 0; i < mc->numThreads; ++i) {
+        threads[i].mc = mc;
+        threads[i].id = i;
+        if (i > 0 && pthread_create(&threads[i].thread, NULL, coreThread, &threads[i]) != 0) {
+            printf("error: can't start core thread\n");
+            exit(1);
+        }
+    }
+    coreThread(&threads[0]);
+    for (int i = 1; i < mc->numThreads; ++i) {
+        pthread_join(threads[i].thread, NULL);
+    }
+    pthread_barrier_destroy(&mc->barrier);
+    free(threads);
+}
+
+/* Per-core CPI and cache statistics, then the shared memory and the
+   coherence traffic. The halt is still in MEM/WB, so it is counted here. */
+static void report(multicoreType* mc, busType* bus) {
+    unsigned int cycles = 0;
+    unsigned long long instructions = 0;
+    unsigned int numMemory = 0;
+    for (int c = 0; c < mc->numCores; ++c) {
+        coreType* core = &mc->cores[c];
+        cycles = core->pipeline.state->cycles > cycles ? core->pipeline.state->cycles : cycles;
+        instructions += core->retired + 1;
+        numMemory = core->mem.numMemory > numMemory ? core->mem.numMemory : numMemory;
+    }
+    printf("Machine halted\n");
+    printf("Total of %u cycles executed\n", cycles);
+    for (int c = 0; c < mc->numCores; ++c) {
+        coreType* core = &mc->cores[c];
+        const stateType* state = core->pipeline.state;
+        printf("core %d: %u cycles, %llu instructions, CPI %.3f, %llu cycles waiting on caches\n",
+            c, state->cycles, core->retired + 1, (double) state->cycles / (core->retired + 1), core->frozen);
+        printf("\tregisters:\n");
+        for (int i = 0; i < NUMREGS; ++i) {
+            printf("\t\treg[ %d ] = %d\n", i, state->reg[i]);
+        }
+    }
+    printf("shared data memory:\n");
+    for (unsigned int i = 0; i < numMemory; ++i) {
+        printf("\tdataMem[ %u ] = %d\n", i, loadWord(&mc->cores[0].mem, (int) i));
+    }
+    printf("%d cores: %llu instructions in %u cycles, IPC %.3f\n", mc->numCores, instructions,
+        cycles, (double) instructions / cycles);
+    for (int c = 0; c < mc->numCores; ++c) {
+        cacheType* caches[] = {mc->cores[c].pipeline.icache, mc->cores[c].pipeline.dcache};
+        for (int i = 0; i < 2; ++i) {
+            if (caches[i] != NULL) {
+                cacheReport(caches[i], stdout);
+            }
+        }
+    }
+    if (bus != NULL) {
+        busReport(bus, stdout);
+    }
+}
+
+/* Runs numCores cores on jobs host threads. With one program every core
+   runs it; otherwise there is one per core. */
+int runMulticore(char** programs, int numPrograms, int numCores, int jobs, bool listing,
+        const cacheConfigType* icache, const cacheConfigType* dcache, int missLatency) {
+    multicoreType mc = {NULL, numCores, jobs < numCores ? jobs : numCores};
+    mc.cores = calloc(numCores, sizeof(coreType));
+    if (mc.cores == NULL) {
+        printf("error: out of memory for %d cores\n", numCores);
+        exit(1);
+    }
+    busType* bus = dcache->sizeWords > 0 ? busCreate() : NULL;
+
+    for (int c = 0; c < numCores; ++c) {
+        coreType* core = &mc.cores[c];
+        if (c > 0 && numPrograms == 1) {
+            memoryShare(&core->mem, &mc.cores[0].mem);
+        } else if (loadMachineCode(&core->mem, programs[c], stdout, listing) != 0) {
+            exit(1);
+        }
+        if (c == 0) {
+            for (int i = 0; i < NUMPAGES; ++i) {
+                if (core->mem.dataPages[i]->refs != 1) {
+                    privatePage(&core->mem.dataPages[i]);
+                }
+            }
+        } else {
+            memoryShareData(&core->mem, &mc.cores[0].mem);
+        }
+
+        pipelineType* p = &core->pipeline;
+        pipelineInit(p, &core->mem);
+        p->holdStores = true;
+        p->state->reg[6] = c;
+        p->state->reg[7] = numCores;
+        if (icache->sizeWords > 0) {
+            snprintf(core->icacheName, sizeof(core->icacheName), "core %d icache", c);
+            p->icache = cacheCreate(core->icacheName, icache, missLatency);
+        }
+        if (dcache->sizeWords > 0) {
+            snprintf(core->dcacheName, sizeof(core->dcacheName), "core %d dcache", c);
+            p->dcache = cacheCreate(core->dcacheName, dcache, missLatency);
+            busAttach(bus, p->dcache);
+        }
+    }
+
+    run(&mc);
+    report(&mc, bus);
+
+    for (int c = 0; c < numCores; ++c) {
+        pipelineType* p = &mc.cores[c].pipeline;
+        if (p->icache != NULL) {
+            cacheFree(p->icache);
+        }
+        if (p->dcache != NULL) {
+            cacheFree(p->dcache);
+        }
+        memoryReset(&mc.cores[c].mem);
+    }
+    if (bus != NULL) {
+        busFree(bus);
+    }
+    free(mc.cores);
+    return 0;
+}
@@ -0,0 +1,32 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Several five-stage pipelines sharing one data memory
+ *
+ * Each core is a pipelineType with its own instruction memory, pc,
+ * registers and latches, and all of them lw and sw one shared dataMem.
+ * It starts out as the first core's program; any other programs are only
+ * instruction memory for their cores. Core i starts with i in r6 and the
+ * number of cores in r7, so one program can split up work.
+ *
+ * Cores advance in lockstep cycles. A sw is held until the cycle ends and
+ * then committed in core order, so every lw sees memory as it was at the
+ * start of its cycle, and the run is the same however the cycles are
+ * spread over host threads. Since a core does at most one lw or sw a
+ * cycle, memory is sequentially consistent. With caches, each core gets its
+ * own, and the data caches are kept coherent with MSI (see cache.h); their
+ * accesses are also made in core order, before the cores run the cycle in
+ * parallel. A halted core stops while the others go on, and the run ends
+ * once every core has halted.
+**/
+
+#ifndef MULTICORE_H
+#define MULTICORE_H
+
+#include "cache.h"
+
+#define MAXCORES 1024
+
+int runMulticore(char** programs, int numPrograms, int numCores, int jobs, bool listing,
+    const cacheConfigType* icache, const cacheConfigType* dcache, int missLatency);
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Project 3: LC-2K Pipeline Simulator
+ * The five-stage pipeline itself, one cycle at a time
+ *
+ * Each variant's cycle comes from including pipelinecycle.h with its
+ * policies defined; pipelineCycle calls the one the pipeline was set to.
+**/
+
+#include <string.h>
+
+#include "pipeline.h"
+
+/* Latch an operand is forwarded from, by the distance of its producer. */
+static const HazType forwardSource[SCOREBOARDDEPTH] = {EXMEM, MEMWB, WBEND};
+
+static void hazardResolver(stateType* state, int* valA, int* valB) {
+
+    if (!state->IDEX.valAHaz) {
+        *valA = state->IDEX.valA;
+    } else if (state->IDEX.valAHaz && state->IDEX.valAhazType == EXMEM) {
+        *valA = state->EXMEM.aluResult;
+    } else if (state->IDEX.valAHaz && state->IDEX.valAhazType == MEMWB) {
+        *valA = state->MEMWB.writeData;
+    } else if (state->IDEX.valAHaz && state->IDEX.valAhazType == WBEND) {
+        *valA = state->WBEND.writeData;
+    }
+
+    if (!state->IDEX.valBHaz) {
+        *valB = state->IDEX.valB;
+    } else if (state->IDEX.valBHaz && state->IDEX.valBhazType == EXMEM) {
+        *valB = state->EXMEM.aluResult;
+    } else if (state->IDEX.valBHaz && state->IDEX.valBhazType == MEMWB) {
+        *valB = state->MEMWB.writeData;
+    } else if (state->IDEX.valBHaz && state->IDEX.valBhazType == WBEND) {
+        *valB = state->WBEND.writeData;
+    }
+}
+
+/* The beq a cycle resolves, from the latch the variant resolves it in. */
+typedef struct branchStruct {
+    bool isBranch;
+    bool taken;
+    bool predTaken;
+    int predIndex;
+    bool mispredict;
+    int instrIdx;
+    int target;
+} branchType;
+
+/* Starts an empty pipeline at pc 0 with every register zero and a noop in
+   every latch. The program must already be loaded into mem. */
+void pipelineInit(pipelineType* p, memoryType* mem) {
+    memset(p, 0, sizeof(*p));
+    p->mem = mem;
+    p->state = &p->stateBuf[0];
+    p->newState = &p->stateBuf[1];
+    pipelineSetVariant(p, pipelineForwardMem);
+
+    stateType* state = p->state;
+    state->mem = mem;
+    state->pc = 0;
+    for (int i = 0; i < 8; i++) {
+        state->reg[i] = 0;
+    }
+    state->IFID.instr = state->IDEX.instr = state->EXMEM.instr = state->MEMWB.instr = state->WBEND.instr = 0x1c00000;
+    state->IFID.instrIdx = state->IDEX.instrIdx = state->EXMEM.instrIdx = state->MEMWB.instrIdx = state->WBEND.instrIdx = NOOPINDEX;
+    pipelineSync(p);
+}
+
+/* Rebuilds the scoreboard from the ID/EX, EX/MEM and MEM/WB latches. */
+void pipelineSync(pipelineType* p) {
+    const decodedType* decoded = p->mem->decoded;
+    const int inFlight[SCOREBOARDDEPTH] = {p->state->MEMWB.instrIdx, p->state->EXMEM.instrIdx,
+        p->state->IDEX.instrIdx};
+    p->scoreboard.pending = 0;
+    p->scoreboard.loads = 0;
+    for (int i = 0; i < SCOREBOARDDEPTH; ++i) {
+        const decodedType* issued = &decoded[inFlight[i]];
+        scoreboardAdvance(&p->scoreboard, &issued, 1);
+    }
+}
+
+/* A variant's name and its specialized functions. */
+typedef struct variantStruct {
+    const char* name;
+    void (*cycle)(pipelineType*);
+    int (*cacheLatency)(pipelineType*);
+    int flushPenalty;
+} variantType;
+
+#define PIPELINEFORWARDS 1
+#define PIPELINEBRANCHEX 0
+#define PIPELINESUFFIX ForwardMem
+#include "pipelinecycle.h"
+
+#define PIPELINEFORWARDS 1
+#define PIPELINEBRANCHEX 1
+#define PIPELINESUFFIX ForwardEx
+#include "pipelinecycle.h"
+
+#define PIPELINEFORWARDS 0
+#define PIPELINEBRANCHEX 0
+#define PIPELINESUFFIX StallMem
+#include "pipelinecycle.h"
+
+#define PIPELINEFORWARDS 0
+#define PIPELINEBRANCHEX 1
+#define PIPELINESUFFIX StallEx
+#include "pipelinecycle.h"
+
+static const variantType variants[NUMPIPELINEVARIANTS] = {
+    [pipelineForwardMem] = {"forward-mem", cycleForwardMem, cacheLatencyForwardMem, MEMFLUSHPENALTY},
+    [pipelineForwardEx] = {"forward-ex", cycleForwardEx, cacheLatencyForwardEx, EXFLUSHPENALTY},
+    [pipelineStallMem] = {"stall-mem", cycleStallMem, cacheLatencyStallMem, MEMFLUSHPENALTY},
+    [pipelineStallEx] = {"stall-ex", cycleStallEx, cacheLatencyStallEx, EXFLUSHPENALTY},
+};
+
+/* Switches to another variant. Takes effect from the next cycle, so it
+   is only meant for an empty pipeline. */
+void pipelineSetVariant(pipelineType* p, pipelineVariant variant) {
+    p->variant = variant;
+    p->cycle = variants[variant].cycle;
+}
+
+bool pipelineParseVariant(const char* name, pipelineVariant* variant) {
+    for (int i = 0; i < NUMPIPELINEVARIANTS; ++i) {
+        if (!strcmp(name, variants[i].name)) {
+            *variant = (pipelineVariant) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* pipelineVariantName(pipelineVariant variant) {
+    return variants[variant].name;
+}
+
+/* Instructions squashed by each mispredict. */
+int pipelineFlushPenalty(const pipelineType* p) {
+    return variants[p->variant].flushPenalty;
+}
+
+/* Charges the coming cycle's accesses to the caches, unless they already
+   are. pipelineCycle does this itself; pipelines whose caches snoop each
+   other call it first, in a fixed order (see multicore.c). */
+void pipelineChargeCaches(pipelineType* p) {
+    if (!p->cacheRetry) {
+        p->cacheStall = variants[p->variant].cacheLatency(p);
+        p->cacheRetry = true;
+    }
+}
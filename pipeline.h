@@ -0,0 +1,70 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Project 3: LC-2K Pipeline Simulator
+ * The five-stage pipeline as a self-contained, reentrant object
+**/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "lc2k.h"
+#include "predictor.h"
+#include "counters.h"
+#include "cache.h"
+#include "scoreboard.h"
+
+#define MEMFLUSHPENALTY 3 // instructions squashed per mispredict, beq resolved in MEM
+#define EXFLUSHPENALTY 2 // and resolved in EX
+
+/* Hazard and branch policies. Each variant is its own copy of the cycle
+   function, specialized at compile time by pipelinecycle.h. */
+typedef enum {
+    pipelineForwardMem, // full forwarding, beq resolved in MEM (the default)
+    pipelineForwardEx, // full forwarding, beq resolved in EX
+    pipelineStallMem, // no forwarding: ID waits until every register it reads is written back
+    pipelineStallEx,
+    NUMPIPELINEVARIANTS
+} pipelineVariant;
+
+/* One pipelined machine. All of its state lives here and in mem, so any
+   number of them can run side by side. */
+typedef struct pipelineStruct {
+    pipelineVariant variant;
+    void (*cycle)(struct pipelineStruct*); // the variant's cycle function
+    memoryType* mem;
+    stateType stateBuf[2];
+    stateType* state; // state before the next cycle
+    stateType* newState; // scratch for the cycle being computed
+    scoreboardType scoreboard; // ID stage hazard detection
+    void (*onStore)(void* ctx, int addr, int value); // called on every sw, or NULL
+    void* onStoreCtx;
+    predictorType* predictor; // NULL always predicts not-taken
+    countersType* counters; // or NULL to count nothing
+    cacheType* icache; // timing models for IF and MEM, or NULL for
+    cacheType* dcache; // single-cycle memory
+    int cacheStall; // cycles left to freeze the pipeline for a miss
+    bool cacheRetry; // this cycle's accesses were already charged to the caches
+    bool holdStores; // leave each sw in heldAddr/heldValue instead of writing
+    bool storeHeld; // mem or calling onStore; the owner commits and clears it
+    int heldAddr;
+    int heldValue;
+} pipelineType;
+
+void pipelineInit(pipelineType*, memoryType*);
+void pipelineSync(pipelineType*);
+void pipelineChargeCaches(pipelineType*);
+void pipelineSetVariant(pipelineType*, pipelineVariant);
+bool pipelineParseVariant(const char* name, pipelineVariant*);
+const char* pipelineVariantName(pipelineVariant);
+int pipelineFlushPenalty(const pipelineType*);
+
+/* Runs one clock cycle: computes newState from state, then swaps them. */
+static inline void pipelineCycle(pipelineType* p) {
+    p->cycle(p);
+}
+
+static inline bool pipelineHalted(const pipelineType* p) {
+    return p->mem->decoded[p->state->MEMWB.instrIdx].opcode == HALT;
+}
+
+#endif
@@ -0,0 +1,328 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Project 3: LC-2K Pipeline Simulator
+ * The cycle of one pipeline variant, included by pipeline.c once per variant
+ *
+ * Define these before each include:
+ *   PIPELINEFORWARDS  1 to forward results to EX, stalling only a lw's
+ *                     immediate consumer; 0 to forward nothing, so ID
+ *                     waits until every register it reads is written back
+ *   PIPELINEBRANCHEX  1 to resolve beq in EX, squashing IF/ID and ID/EX on
+ *                     a mispredict; 0 to resolve it in MEM, squashing
+ *                     EX/MEM as well
+ *   PIPELINESUFFIX    appended to the names of the functions defined here
+ * The policies are settled by the preprocessor, so no variant's cycle
+ * tests which variant it is. There is no include guard on purpose.
+**/
+
+#ifndef VARIANTNAME
+#define PASTENAME(name, suffix) name##suffix
+#define EXPANDNAME(name, suffix) PASTENAME(name, suffix)
+#define VARIANTNAME(name) EXPANDNAME(name, PIPELINESUFFIX)
+#endif
+
+/* These are macros rather than functions so that even an unoptimized
+   build has nothing to call in the cycle. */
+
+/* The operands EX uses this cycle. */
+#if PIPELINEFORWARDS
+#define OPERANDS(state, valA, valB) hazardResolver(state, &(valA), &(valB))
+#else
+#define OPERANDS(state, valA, valB) ((valA) = (state)->IDEX.valA, (valB) = (state)->IDEX.valB)
+#endif
+
+/* The beq, if any, that is resolved this cycle, into a branchType. */
+#if PIPELINEBRANCHEX
+#define RESOLVEBRANCH(state, decoded, valA, valB, branch) do { \
+        (branch).isBranch = (decoded)[(state)->IDEX.instrIdx].opcode == BEQ; \
+        (branch).taken = (branch).isBranch && (valA) == (valB); \
+        (branch).predTaken = (state)->IDEX.predTaken; \
+        (branch).predIndex = (state)->IDEX.predIndex; \
+        (branch).instrIdx = (state)->IDEX.instrIdx; \
+        (branch).target = (state)->IDEX.pcPlus1 + (state)->IDEX.offset; \
+        (branch).mispredict = (branch).isBranch && (branch).taken != (branch).predTaken; \
+    } while (0)
+#else
+#define RESOLVEBRANCH(state, decoded, valA, valB, branch) do { \
+        (branch).isBranch = (decoded)[(state)->EXMEM.instrIdx].opcode == BEQ; \
+        (branch).taken = (branch).isBranch && (state)->EXMEM.eq == 1; \
+        (branch).predTaken = (state)->EXMEM.predTaken; \
+        (branch).predIndex = (state)->EXMEM.predIndex; \
+        (branch).instrIdx = (state)->EXMEM.instrIdx; \
+        (branch).target = (state)->EXMEM.branchTarget; \
+        (branch).mispredict = (branch).isBranch && (branch).taken != (branch).predTaken; \
+        (void) (valA), (void) (valB); \
+    } while (0)
+#endif
+
+/* Charges this cycle's instruction fetch and lw/sw to the caches. Returns
+   the cycles to wait for any misses before the cycle can go ahead. */
+static int VARIANTNAME(cacheLatency)(pipelineType* p) {
+    stateType* state = p->state;
+    const decodedType* exmem = &p->mem->decoded[state->EXMEM.instrIdx];
+    int latency = 0;
+    if (p->icache != NULL) {
+        // after a mispredict IF fetches nothing this cycle
+        int valA = 0;
+        int valB = 0;
+        branchType branch;
+        OPERANDS(state, valA, valB);
+        RESOLVEBRANCH(state, p->mem->decoded, valA, valB, branch);
+        if (!branch.mispredict) {
+            latency += cacheAccess(p->icache, state->pc, false);
+        }
+    }
+    if (p->dcache != NULL && (exmem->opcode == LW || exmem->opcode == SW)) {
+        latency += cacheAccess(p->dcache, state->EXMEM.aluResult, exmem->opcode == SW);
+    }
+    return latency;
+}
+
+/* Runs one clock cycle: computes newState from state, then swaps them. */
+static void VARIANTNAME(cycle)(pipelineType* p) {
+    memoryType* mem = p->mem;
+    stateType* state = p->state;
+    stateType* newState = p->newState;
+    scoreboardType* scoreboard = &p->scoreboard;
+    countersType* counters = p->counters;
+    bool stall = false;
+
+    /* A cycle that misses in a cache is preceded by the miss latency's
+       worth of cycles in which nothing moves. */
+    if ((p->icache != NULL || p->dcache != NULL) && !p->cacheRetry) {
+        p->cacheStall = VARIANTNAME(cacheLatency)(p);
+        p->cacheRetry = true;
+    }
+    if (p->cacheStall > 0) {
+        p->cacheStall--;
+        state->cycles += 1;
+        if (counters != NULL) {
+            counters->cacheStallCycles++;
+        }
+        return;
+    }
+    p->cacheRetry = false;
+
+    /* Stages only rewrite the latch fields they own, so the new cycle
+       starts from a copy of the old one. Memory is not part of it. */
+    *newState = *state;
+
+    newState->cycles += 1;
+
+    /* ---------------------- IF stage --------------------- */
+    const decodedType* ifid = &mem->decoded[state->IFID.instrIdx];
+    const decodedType* idex = &mem->decoded[state->IDEX.instrIdx];
+    const decodedType* exmem = &mem->decoded[state->EXMEM.instrIdx];
+    const decodedType* memwb = &mem->decoded[state->MEMWB.instrIdx];
+    int valA = 0;
+    int valB = 0;
+    branchType branch;
+    OPERANDS(state, valA, valB);
+    RESOLVEBRANCH(state, mem->decoded, valA, valB, branch);
+    bool mispredict = branch.mispredict;
+    // a beq can send pc out of memory; fetch wraps it the way loadWord does
+    int fetchPc = (unsigned int) state->pc % NUMMEMORY;
+    int predictedTarget = 0;
+    int predIndex = 0;
+    bool predictTaken = p->predictor != NULL && predictorFetch(p->predictor, fetchPc, &predictedTarget,
+        &predIndex);
+
+    if (branch.isBranch && p->predictor != NULL) {
+        predictorResolve(p->predictor, branch.instrIdx, branch.predIndex, branch.taken, branch.target,
+            branch.predTaken);
+    }
+
+    if (mispredict) {
+        if (counters != NULL) {
+            counters->mispredicts++;
+            counters->flushCycles += PIPELINEBRANCHEX ? EXFLUSHPENALTY : MEMFLUSHPENALTY;
+        }
+        int target = branch.taken ? branch.target : branch.instrIdx + 1;
+        newState->pc = target;
+        newState->IFID.pcPlus1 = target + 1;
+        newState->IFID.instr = NOOPINSTR;
+        newState->IFID.instrIdx = NOOPINDEX;
+        newState->IFID.predTaken = false;
+        newState->IFID.predIndex = 0;
+    } else {
+        newState->pc = predictTaken ? predictedTarget : fetchPc + 1;
+        newState->IFID.pcPlus1 = fetchPc + 1;
+        newState->IFID.instr = mem->decoded[fetchPc].instr;
+        newState->IFID.instrIdx = fetchPc;
+        newState->IFID.predTaken = predictTaken;
+        newState->IFID.predIndex = predIndex;
+    }
+
+    /* ---------------------- ID stage --------------------- */
+    if (!mispredict) {
+        newState->IDEX.pcPlus1 = state->IFID.pcPlus1;
+        newState->IDEX.valA = state->reg[ifid->regA];
+        newState->IDEX.valB = state->reg[ifid->regB];
+        newState->IDEX.offset = ifid->offset;
+        newState->IDEX.instr = state->IFID.instr;
+        newState->IDEX.instrIdx = state->IFID.instrIdx;
+        newState->IDEX.predTaken = state->IFID.predTaken;
+        newState->IDEX.predIndex = state->IFID.predIndex;
+
+        newState->IDEX.valAHaz = false;
+        newState->IDEX.valAhazType = noHaz;
+        newState->IDEX.valBHaz = false;
+        newState->IDEX.valBhazType = noHaz;
+
+        // add, nor, sw and beq read regA and regB; lw reads only regA
+        bool readsA = ifid->opcode == ADD || ifid->opcode == NOR || ifid->opcode == SW
+            || ifid->opcode == BEQ || ifid->opcode == LW;
+        bool readsB = readsA && ifid->opcode != LW;
+        int producerA = readsA ? scoreboardProducer(scoreboard, ifid->regA, 0) : -1;
+        int producerB = readsB ? scoreboardProducer(scoreboard, ifid->regB, 0) : -1;
+
+#if PIPELINEFORWARDS
+        /* A lw one stage ahead has no value to forward yet. Hold IF/ID, send
+           a bubble to EX, and leave the forwarding flags as the older
+           producers alone would set them. */
+        stall = (producerA == 0 || producerB == 0) && (scoreboard->loads & 1);
+        if (stall) {
+            producerA = readsA ? scoreboardProducer(scoreboard, ifid->regA, 1) : -1;
+            producerB = readsB ? scoreboardProducer(scoreboard, ifid->regB, 1) : -1;
+        }
+        if (producerA >= 0) {
+            newState->IDEX.valAHaz = true;
+            newState->IDEX.valAhazType = forwardSource[producerA];
+        }
+        if (producerB >= 0) {
+            newState->IDEX.valBHaz = true;
+            newState->IDEX.valBhazType = forwardSource[producerB];
+        }
+#else
+        /* The register file is the only source, and a write in WB this
+           cycle is too late for it, so any producer still in flight
+           holds the reader in ID. */
+        stall = producerA >= 0 || producerB >= 0;
+#endif
+
+        if (stall) {
+            newState->IDEX.instr = NOOPINSTR;
+            newState->IDEX.instrIdx = NOOPINDEX;
+            newState->IDEX.predTaken = false;
+            newState->IDEX.predIndex = 0;
+            newState->pc = state->pc;
+            newState->IFID = state->IFID;
+            if (counters != NULL) {
+#if PIPELINEFORWARDS
+                counters->loadUseStalls++;
+#else
+                counters->rawStalls++;
+#endif
+                counters->pcs[state->IFID.instrIdx].stalls++;
+            }
+        }
+    } else {
+        newState->IDEX.instr = NOOPINSTR;
+        newState->IDEX.instrIdx = NOOPINDEX;
+        newState->IDEX.predTaken = false;
+        newState->IDEX.predIndex = 0;
+    }
+
+    /* ---------------------- EX stage --------------------- */
+    // a beq resolved in EX goes on to MEM; one resolved in MEM squashes EX
+    if (PIPELINEBRANCHEX || !mispredict) {
+        newState->EXMEM.branchTarget = state->IDEX.pcPlus1 + state->IDEX.offset;
+#if PIPELINEFORWARDS
+        if (counters != NULL && state->IDEX.instrIdx != NOOPINDEX) {
+            if (state->IDEX.valAHaz) {
+                counters->forwards[state->IDEX.valAhazType]++;
+            }
+            if (state->IDEX.valBHaz) {
+                counters->forwards[state->IDEX.valBhazType]++;
+            }
+        }
+#endif
+        switch (idex->opcode) {
+            case ADD:
+                newState->EXMEM.aluResult = valA + valB;
+                break;
+            case NOR:
+                newState->EXMEM.aluResult = ~(valA | valB);
+                break;
+            case LW:
+            case SW:
+                newState->EXMEM.aluResult = valA + state->IDEX.offset;
+                break;
+            case BEQ:
+                newState->EXMEM.eq = (valA == valB);
+                break;
+        }
+        newState->EXMEM.valB = valB;
+        newState->EXMEM.instr = state->IDEX.instr;
+        newState->EXMEM.instrIdx = state->IDEX.instrIdx;
+        newState->EXMEM.predTaken = state->IDEX.predTaken;
+        newState->EXMEM.predIndex = state->IDEX.predIndex;
+    } else {
+        newState->EXMEM.instr = NOOPINSTR;
+        newState->EXMEM.instrIdx = NOOPINDEX;
+        newState->EXMEM.predTaken = false;
+        newState->EXMEM.predIndex = 0;
+    }
+
+    /* --------------------- MEM stage --------------------- */
+    switch (exmem->opcode) {
+        case ADD:
+        case NOR:
+            newState->MEMWB.writeData = state->EXMEM.aluResult;
+            break;
+        case LW:
+            newState->MEMWB.writeData = loadWord(mem, state->EXMEM.aluResult);
+            break;
+        case SW:
+            if (p->holdStores) {
+                p->storeHeld = true;
+                p->heldAddr = state->EXMEM.aluResult;
+                p->heldValue = state->EXMEM.valB;
+                break;
+            }
+            storeWord(mem, state->EXMEM.aluResult, state->EXMEM.valB);
+            if (p->onStore != NULL) {
+                // the word that was actually written, since addresses wrap
+                p->onStore(p->onStoreCtx, (int) ((unsigned int) state->EXMEM.aluResult % NUMMEMORY),
+                    state->EXMEM.valB);
+            }
+            break;
+    }
+    newState->MEMWB.instr = state->EXMEM.instr;
+    newState->MEMWB.instrIdx = state->EXMEM.instrIdx;
+
+    /* ---------------------- WB stage --------------------- */
+    newState->WBEND.writeData = state->MEMWB.writeData;
+    if (counters != NULL && state->MEMWB.instrIdx != NOOPINDEX) {
+        counters->retired++;
+        counters->opcodes[memwb->opcode >= 0 && memwb->opcode < NUMOPCODES ? memwb->opcode : NUMOPCODES]++;
+        counters->pcs[state->MEMWB.instrIdx].retired++;
+    }
+
+    // an add or nor naming a register past the last one writes nothing
+    int written = writtenReg(memwb);
+    if (written >= 0) {
+        newState->reg[written] = state->MEMWB.writeData;
+    }
+
+    newState->WBEND.instr = state->MEMWB.instr;
+    newState->WBEND.instrIdx = state->MEMWB.instrIdx;
+
+    const decodedType* issued = &mem->decoded[newState->IDEX.instrIdx];
+    scoreboardAdvance(scoreboard, &issued, 1);
+    if (!PIPELINEBRANCHEX && mispredict) {
+        // what was in ID/EX has just been squashed out of EX/MEM
+        scoreboardSquash(scoreboard, 1, 1);
+    }
+
+    /* ------------------------ END ------------------------ */
+    p->state = newState; /* this is the last statement of the cycle. It marks the end
+    of the cycle and makes the values calculated in this cycle the current state */
+    p->newState = state;
+}
+
+#undef OPERANDS
+#undef RESOLVEBRANCH
+#undef PIPELINEFORWARDS
+#undef PIPELINEBRANCHEX
+#undef PIPELINESUFFIX
@@ -0,0 +1,134 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Branch target buffer, direction predictors and their statistics
+**/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "predictor.h"
+
+#define COUNTERMASK ((1 << PREDICTORBITS) - 1)
+
+static const char* kindNames[] = {"not-taken", "btfn", "bimodal", "gshare"};
+
+predictorType* predictorCreate(predictorKind kind, int btbEntries) {
+    if (btbEntries <= 0 || (btbEntries & (btbEntries - 1)) != 0) {
+        printf("error: BTB size %d is not a power of two\n", btbEntries);
+        exit(1);
+    }
+    predictorType* pred = calloc(1, sizeof(predictorType));
+    if (pred != NULL) {
+        pred->btb = malloc(btbEntries * sizeof(btbEntryType));
+        pred->stats = calloc(NUMMEMORY, sizeof(branchStatsType));
+    }
+    if (pred == NULL || pred->btb == NULL || pred->stats == NULL) {
+        printf("error: out of memory for branch predictor\n");
+        exit(1);
+    }
+    pred->kind = kind;
+    pred->btbEntries = btbEntries;
+    for (int i = 0; i < btbEntries; ++i) {
+        pred->btb[i].pc = -1;
+    }
+    // weakly not-taken
+    memset(pred->counters, 1, sizeof(pred->counters));
+    return pred;
+}
+
+bool predictorParseKind(const char* name, predictorKind* kind) {
+    for (int i = 0; i < sizeof(kindNames) / sizeof(kindNames[0]); ++i) {
+        if (!strcmp(name, kindNames[i])) {
+            *kind = (predictorKind) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static int counterIndex(predictorType* pred, int pc) {
+    unsigned int index = pc;
+    if (pred->kind == predictGshare) {
+        index ^= pred->history;
+    }
+    return index & COUNTERMASK;
+}
+
+/* Predicts the instruction being fetched from pc. Returns true, with the
+   address to fetch next in *target, if it should be treated as taken.
+   *index is the counter to train once it resolves, hit or miss. */
+bool predictorFetch(predictorType* pred, int pc, int* target, int* index) {
+    *index = counterIndex(pred, pc);
+    btbEntryType* entry = &pred->btb[pc & (pred->btbEntries - 1)];
+    if (entry->pc != pc) {
+        return false;
+    }
+    bool taken;
+    switch (pred->kind) {
+        case predictBTFN:
+            taken = entry->target <= pc;
+            break;
+        case predictBimodal:
+        case predictGshare:
+            taken = pred->counters[*index] >= 2;
+            break;
+        default:
+            taken = false;
+            break;
+    }
+    *target = entry->target;
+    return taken;
+}
+
+/* Trains on a beq at pc that has just been resolved, whose prediction
+   came from counter index. */
+void predictorResolve(predictorType* pred, int pc, int index, bool taken, int target, bool predictedTaken) {
+    branchStatsType* stats = &pred->stats[pc];
+    stats->executed++;
+    stats->taken += taken;
+    stats->correct += taken == predictedTaken;
+
+    btbEntryType* entry = &pred->btb[pc & (pred->btbEntries - 1)];
+    if (taken) {
+        if (entry->pc != pc) {
+            pred->btbMisses++;
+        }
+        entry->pc = pc;
+        entry->target = target;
+    }
+
+    unsigned char* counter = &pred->counters[index & COUNTERMASK];
+    if (taken && *counter < 3) {
+        ++*counter;
+    } else if (!taken && *counter > 0) {
+        --*counter;
+    }
+    pred->history = ((pred->history << 1) | taken) & COUNTERMASK;
+}
+
+void predictorReport(predictorType* pred, int flushPenalty, FILE* out) {
+    unsigned long long executed = 0, correct = 0;
+    for (int pc = 0; pc < NUMMEMORY; ++pc) {
+        executed += pred->stats[pc].executed;
+        correct += pred->stats[pc].correct;
+    }
+    fprintf(out, "branch predictor: %s, %d BTB entries\n", kindNames[pred->kind], pred->btbEntries);
+    fprintf(out, "\tbranches %llu, mispredicted %llu, accuracy %.2f%%\n", executed, executed - correct,
+        executed ? 100.0 * correct / executed : 100.0);
+    fprintf(out, "\tflush cycles %llu, BTB misses on taken branches %llu\n",
+        (executed - correct) * flushPenalty, pred->btbMisses);
+    for (int pc = 0; pc < NUMMEMORY; ++pc) {
+        branchStatsType* stats = &pred->stats[pc];
+        if (stats->executed == 0) {
+            continue;
+        }
+        fprintf(out, "\tbeq at %d: executed %llu, taken %llu, accuracy %.2f%%\n", pc,
+            stats->executed, stats->taken, 100.0 * stats->correct / stats->executed);
+    }
+}
+
+void predictorFree(predictorType* pred) {
+    free(pred->btb);
+    free(pred->stats);
+    free(pred);
+}
@@ -0,0 +1,65 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Branch prediction for the IF stage
+ *
+ * IF looks the fetch pc up in a direct-mapped branch target buffer. On a
+ * hit the direction predictor decides whether to fetch from the stored
+ * target next cycle. A beq is resolved in EX or MEM, depending on the
+ * pipeline variant; if the prediction it carried down the pipeline was
+ * wrong, the younger instructions are squashed, exactly as a taken branch
+ * always was. The beq also carries the index of the counter that predicted
+ * it, so gshare trains the counter it read rather than one indexed by the
+ * history as it stands at resolve.
+ *
+ *   not-taken  always fall through (the original behavior)
+ *   btfn       taken if the BTB target is backward
+ *   bimodal    2-bit counters indexed by pc
+ *   gshare     2-bit counters indexed by pc xor global history
+**/
+
+#ifndef PREDICTOR_H
+#define PREDICTOR_H
+
+#include <stdio.h>
+
+#include "lc2k.h"
+
+#define PREDICTORBITS 12 // log2 of the number of 2-bit counters
+#define DEFAULTBTBENTRIES 64
+
+typedef enum {
+    predictNotTaken,
+    predictBTFN,
+    predictBimodal,
+    predictGshare,
+} predictorKind;
+
+typedef struct btbEntryStruct {
+    int pc; // tag, or -1 if empty
+    int target;
+} btbEntryType;
+
+typedef struct branchStatsStruct {
+    unsigned long long executed;
+    unsigned long long taken;
+    unsigned long long correct;
+} branchStatsType;
+
+typedef struct predictorStruct {
+    predictorKind kind;
+    unsigned char counters[1 << PREDICTORBITS];
+    unsigned int history; // outcomes of the last PREDICTORBITS branches, newest in bit 0
+    btbEntryType* btb;
+    int btbEntries; // a power of two
+    branchStatsType* stats; // per instruction address
+    unsigned long long btbMisses; // taken branches that missed in the BTB
+} predictorType;
+
+predictorType* predictorCreate(predictorKind, int btbEntries);
+bool predictorParseKind(const char* name, predictorKind*);
+bool predictorFetch(predictorType*, int pc, int* target, int* index);
+void predictorResolve(predictorType*, int pc, int index, bool taken, int target, bool predictedTaken);
+void predictorReport(predictorType*, int flushPenalty, FILE*);
+void predictorFree(predictorType*);
+
+#endif
@@ -0,0 +1,256 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Printing states from a writer thread, see printer.h
+ *
+ * head and tail only ever grow, and only the simulation writes head and
+ * only the writer writes tail, so neither takes the lock to move along the
+ * ring. The lock and condition variable are only for sleeping: a side sets
+ * its waiting flag before it looks at the other side's index one last time,
+ * and the other side looks at the flag after moving its index, so one of
+ * them always sees the other.
+**/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "printer.h"
+
+static printerType* openPrinter; // written out by exit if still open
+
+static void wakeUp(printerType* pr) {
+    pthread_mutex_lock(&pr->lock);
+    pthread_cond_signal(&pr->wake);
+    pthread_mutex_unlock(&pr->lock);
+}
+
+/* ------------------------- simulation side ------------------------- */
+
+/* The slot at head, once the writer has made room for it. */
+static printerSlotType* nextSlot(printerType* pr) {
+    if (pr->head - pr->knownTail == PRINTERSLOTS) {
+        pr->knownTail = __atomic_load_n(&pr->tail, __ATOMIC_ACQUIRE);
+    }
+    if (pr->head - pr->knownTail == PRINTERSLOTS) {
+        pthread_mutex_lock(&pr->lock);
+        __atomic_store_n(&pr->producerWaiting, true, __ATOMIC_SEQ_CST);
+        while (pr->head - (pr->knownTail = __atomic_load_n(&pr->tail, __ATOMIC_SEQ_CST)) > PRINTERSLOTS / 2) {
+            pthread_cond_wait(&pr->wake, &pr->lock);
+        }
+        __atomic_store_n(&pr->producerWaiting, false, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&pr->lock);
+    }
+    return &pr->slots[pr->head % PRINTERSLOTS];
+}
+
+static void publish(printerType* pr) {
+    __atomic_store_n(&pr->head, pr->head + 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pr->consumerWaiting, __ATOMIC_SEQ_CST) && pr->head - pr->knownTail >= PRINTERSLOTS / 2) {
+        wakeUp(pr);
+    }
+}
+
+/* Only the words printState shows are kept, so other stores are dropped. */
+void printerNoteStore(printerType* pr, int addr, int value) {
+    if (addr < 0 || addr >= pr->mem.numMemory) {
+        return;
+    }
+    printerSlotType* slot = nextSlot(pr);
+    slot->isStore = true;
+    slot->addr = addr;
+    slot->value = value;
+    publish(pr);
+}
+
+void printerPushState(printerType* pr, stateType* state) {
+    printerSlotType* slot = nextSlot(pr);
+    slot->isStore = false;
+    slot->state = *state;
+    publish(pr);
+}
+
+/* ------------------------- writer side ------------------------- */
+
+/* Writes out every buffer with anything in it. After a failed write the
+   rest of the output is dropped, and printerFree reports it. */
+static void writeBufs(printerType* pr) {
+    struct iovec iov[PRINTERBUFS];
+    int numIov = 0;
+    for (int i = 0; i <= pr->numFull && i < PRINTERBUFS; ++i) {
+        off_t len = ftello(pr->bufs[i].file);
+        if (len > 0) {
+            iov[numIov].iov_base = pr->bufs[i].data;
+            iov[numIov].iov_len = (size_t) len;
+            ++numIov;
+        }
+        fseeko(pr->bufs[i].file, 0, SEEK_SET);
+    }
+    pr->numFull = 0;
+
+    struct iovec* next = iov;
+    while (numIov > 0 && !pr->failed) {
+        ssize_t written = writev(pr->fd, next, numIov);
+        if (written < 0) {
+            pr->failed = errno != EINTR;
+            continue;
+        }
+        while (numIov > 0 && (size_t) written >= next->iov_len) {
+            written -= (ssize_t) next->iov_len;
+            ++next;
+            --numIov;
+        }
+        if (numIov > 0) {
+            next->iov_base = (char*) next->iov_base + written;
+            next->iov_len -= (size_t) written;
+        }
+    }
+}
+
+static void printSlot(printerType* pr, printerSlotType* slot) {
+    if (slot->isStore) {
+        storeWord(&pr->mem, slot->addr, slot->value);
+        return;
+    }
+    printerBufType* buf = &pr->bufs[pr->numFull];
+    slot->state.mem = &pr->mem;
+    fprintState(buf->file, &slot->state); // flushes into buf->data
+    if (ftello(buf->file) >= PRINTERBUFBYTES && ++pr->numFull == PRINTERBUFS) {
+        writeBufs(pr);
+    }
+}
+
+/* Sleeps until the ring is half full, PRINTERWAKEMS pass with something in
+   it, or it is closed, and returns head. head == tail means closed and
+   empty. */
+static unsigned long long waitForSlots(printerType* pr) {
+    unsigned long long head = __atomic_load_n(&pr->head, __ATOMIC_ACQUIRE);
+    if (head - pr->tail >= PRINTERSLOTS / 2) {
+        return head;
+    }
+    pthread_mutex_lock(&pr->lock);
+    __atomic_store_n(&pr->consumerWaiting, true, __ATOMIC_SEQ_CST);
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += PRINTERWAKEMS * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+    while (!pr->closed && (head = __atomic_load_n(&pr->head, __ATOMIC_SEQ_CST)) - pr->tail < PRINTERSLOTS / 2) {
+        if (pthread_cond_timedwait(&pr->wake, &pr->lock, &deadline) == ETIMEDOUT) {
+            if (__atomic_load_n(&pr->head, __ATOMIC_SEQ_CST) != pr->tail) {
+                break;
+            }
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += PRINTERWAKEMS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+        }
+    }
+    head = __atomic_load_n(&pr->head, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&pr->consumerWaiting, false, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&pr->lock);
+    return head;
+}
+
+static void* writerThread(void* arg) {
+    printerType* pr = arg;
+    unsigned long long head;
+    while ((head = waitForSlots(pr)) != pr->tail) {
+        for (unsigned long long t = pr->tail; t != head; ++t) {
+            printSlot(pr, &pr->slots[t % PRINTERSLOTS]);
+            // let a waiting simulation go on as soon as half the ring is free
+            if ((t + 1) % (PRINTERSLOTS / 2) == 0 || t + 1 == head) {
+                __atomic_store_n(&pr->tail, t + 1, __ATOMIC_SEQ_CST);
+                if (__atomic_load_n(&pr->producerWaiting, __ATOMIC_SEQ_CST)) {
+                    wakeUp(pr);
+                }
+            }
+        }
+        writeBufs(pr);
+    }
+    return NULL;
+}
+
+/* ------------------------- setup ------------------------- */
+
+/* Writes out everything queued and stops the writer. Returns whether all
+   of it was written. */
+static bool closePrinter(printerType* pr) {
+    pthread_mutex_lock(&pr->lock);
+    pr->closed = true;
+    pthread_cond_signal(&pr->wake);
+    pthread_mutex_unlock(&pr->lock);
+    pthread_join(pr->thread, NULL);
+    openPrinter = NULL;
+
+    bool ok = !pr->failed;
+    for (int i = 0; i < PRINTERBUFS; ++i) {
+        fclose(pr->bufs[i].file);
+        free(pr->bufs[i].data);
+    }
+    pthread_cond_destroy(&pr->wake);
+    pthread_mutex_destroy(&pr->lock);
+    memoryReset(&pr->mem);
+    free(pr->slots);
+    free(pr);
+    return ok;
+}
+
+static void closeAtExit(void) {
+    if (openPrinter != NULL) {
+        closePrinter(openPrinter);
+    }
+}
+
+/* Starts printing to out states whose dataMem starts out as mem's. Only
+   one printer can be open at a time. */
+printerType* printerCreate(FILE* out, memoryType* mem) {
+    static bool registered = false;
+    printerType* pr = calloc(1, sizeof(printerType));
+    if (pr == NULL || (pr->slots = malloc(PRINTERSLOTS * sizeof(printerSlotType))) == NULL) {
+        printf("error: out of memory for the state printer\n");
+        exit(1);
+    }
+    for (int i = 0; i < PRINTERBUFS; ++i) {
+        pr->bufs[i].file = open_memstream(&pr->bufs[i].data, &pr->bufs[i].size);
+        if (pr->bufs[i].file == NULL) {
+            printf("error: out of memory for the state printer\n");
+            exit(1);
+        }
+    }
+
+    // every page the writer stores to is its own from here on
+    memoryReset(&pr->mem);
+    pr->mem.numMemory = mem->numMemory;
+    for (int i = 0; i < mem->numMemory; ++i) {
+        storeWord(&pr->mem, i, loadWord(mem, i));
+    }
+
+    fflush(out);
+    pr->fd = fileno(out);
+    pthread_mutex_init(&pr->lock, NULL);
+    pthread_cond_init(&pr->wake, NULL);
+    if (pthread_create(&pr->thread, NULL, writerThread, pr) != 0) {
+        printf("error: can't start the state printer\n");
+        exit(1);
+    }
+    openPrinter = pr;
+    if (!registered) {
+        atexit(closeAtExit);
+        registered = true;
+    }
+    return pr;
+}
+
+/* Writes out everything queued and frees the printer. */
+void printerFree(printerType* pr) {
+    if (!closePrinter(pr)) {
+        printf("error: failed writing output\n");
+        exit(1);
+    }
+}
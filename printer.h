@@ -0,0 +1,72 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Printing states from a writer thread, so the simulation never waits on
+ * the terminal or pipe it prints to
+ *
+ * The simulation pushes each state to print, and every sw in between, onto
+ * a single-producer single-consumer ring. A writer thread keeps its own copy
+ * of the printed part of dataMem, formats the states with fprintState into
+ * a few large buffers and hands them to writev together. The output is byte
+ * for byte what printState would have printed.
+ *
+ * A full ring makes the simulation wait until the writer has emptied half
+ * of it. The writer wakes up once the ring is half full, when it is closed,
+ * or every PRINTERWAKEMS ms otherwise, so a long run still shows progress.
+ * Nothing else may write to the output between printerCreate and
+ * printerFree; printerFree writes everything still queued, and so does exit
+ * if the simulation stops on an error first.
+**/
+
+#ifndef PRINTER_H
+#define PRINTER_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+#include "lc2k.h"
+
+#define PRINTERSLOTS 4096 // a power of two
+#define PRINTERWAKEMS 50
+#define PRINTERBUFS 8 // buffers per writev
+#define PRINTERBUFBYTES (256 * 1024) // a buffer is written once it holds this much
+
+/* A state to print, or a sw to apply to the writer's dataMem. */
+typedef struct printerSlotStruct {
+    bool isStore;
+    int addr;
+    int value;
+    stateType state;
+} printerSlotType;
+
+typedef struct printerBufStruct {
+    FILE* file; // open_memstream over data
+    char* data;
+    size_t size;
+} printerBufType;
+
+typedef struct printerStruct {
+    printerSlotType* slots;
+    unsigned long long head; // next slot the simulation fills
+    unsigned long long tail; // next slot the writer reads
+    unsigned long long knownTail; // the simulation's last look at tail
+    bool producerWaiting; // set while the simulation sleeps on a full ring
+    bool consumerWaiting; // set while the writer sleeps
+    bool closed;
+    pthread_mutex_t lock; // only for sleeping and waking up
+    pthread_cond_t wake;
+    pthread_t thread;
+
+    // owned by the writer thread
+    int fd;
+    memoryType mem; // instrMem unused, dataMem [0, numMemory) private
+    printerBufType bufs[PRINTERBUFS];
+    int numFull; // bufs before this one are ready to write
+    bool failed;
+} printerType;
+
+printerType* printerCreate(FILE* out, memoryType* mem);
+void printerNoteStore(printerType*, int addr, int value);
+void printerPushState(printerType*, stateType*);
+void printerFree(printerType*);
+
+#endif
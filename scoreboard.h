@@ -0,0 +1,71 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Register scoreboard for the ID stage
+ *
+ * Byte r of pending has one bit per issue slot between ID and WB that
+ * holds an instruction which will write register r. With an issue width
+ * of w, the slot for lane l at distance d past ID (0 for ID/EX, 1 for
+ * EX/MEM, 2 for MEM/WB) is d * w + (w - 1 - l), so lower slots hold
+ * younger instructions and the closest producer of a register is found
+ * with one bit scan. loads has the same bit set when the slot holds a lw.
+ * SCOREBOARDDEPTH * width must fit in a byte.
+**/
+
+#ifndef SCOREBOARD_H
+#define SCOREBOARD_H
+
+#include "lc2k.h"
+
+#define SCOREBOARDDEPTH 3
+
+typedef struct scoreboardStruct {
+    unsigned long long pending;
+    unsigned int loads;
+} scoreboardType;
+
+// the given slot bits in every register's byte of pending
+#define EVERYREG(bits) ((unsigned long long) (bits) * 0x0101010101010101ull)
+
+/* The register an instruction will write, or -1. */
+static inline int writtenReg(const decodedType* d) {
+    if (d->opcode == ADD || d->opcode == NOR) {
+        return d->dest < NUMREGS ? d->dest : -1;
+    } else if (d->opcode == LW) {
+        return d->regB;
+    }
+    return -1;
+}
+
+/* Moves every pending write one stage further from ID, dropping those
+   that reach WB/END, and records the width instructions ID just issued
+   (bubbles included). */
+static inline void scoreboardAdvance(scoreboardType* sb, const decodedType* const* issued, int width) {
+    unsigned int slots = (1u << (SCOREBOARDDEPTH * width)) - 1;
+    sb->pending = (sb->pending << width) & EVERYREG(slots);
+    sb->loads = (sb->loads << width) & slots;
+    for (int lane = 0; lane < width; ++lane) {
+        int reg = writtenReg(issued[lane]);
+        int slot = width - 1 - lane;
+        if (reg >= 0) {
+            sb->pending |= 1ull << (reg * 8 + slot);
+            sb->loads |= (unsigned int) (issued[lane]->opcode == LW) << slot;
+        }
+    }
+}
+
+/* Forgets the instructions in slots [first, first + count), which a
+   branch has squashed. */
+static inline void scoreboardSquash(scoreboardType* sb, int first, int count) {
+    unsigned int slots = ((1u << count) - 1) << first;
+    sb->pending &= ~EVERYREG(slots);
+    sb->loads &= ~slots;
+}
+
+/* Slot of the youngest instruction that writes reg, ignoring slots below
+   minSlot, or -1 if there is none. */
+static inline int scoreboardProducer(const scoreboardType* sb, int reg, int minSlot) {
+    unsigned int writers = (unsigned int) (sb->pending >> (reg * 8)) & (0xffu << minSlot) & 0xffu;
+    return writers ? __builtin_ctz(writers) : -1;
+}
+
+#endif
@@ -0,0 +1,157 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * The pipeline simulator as a library, see sim.h
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim.h"
+#include "loader.h"
+#include "checkpoint.h"
+#include "functional.h"
+#include "jit.h"
+
+/* Starts an empty pipeline on whatever is in sim->mem, keeping everything
+   attached to the old one. */
+static void startPipeline(simType* sim) {
+    pipelineType old = sim->pipeline;
+    pipelineInit(&sim->pipeline, &sim->mem);
+    pipelineSetVariant(&sim->pipeline, old.variant);
+    sim->pipeline.onStore = old.onStore;
+    sim->pipeline.onStoreCtx = old.onStoreCtx;
+    sim->pipeline.predictor = old.predictor;
+    sim->pipeline.counters = old.counters;
+    sim->pipeline.icache = old.icache;
+    sim->pipeline.dcache = old.dcache;
+}
+
+/* Returns a machine holding an empty program (all of memory zero). */
+simType* simCreate(void) {
+    simType* sim = calloc(1, sizeof(simType));
+    if (sim == NULL) {
+        printf("error: out of memory for a simulator\n");
+        exit(1);
+    }
+    simLoadWords(sim, NULL, 0);
+    return sim;
+}
+
+void simFree(simType* sim) {
+    memoryReset(&sim->mem);
+    free(sim);
+}
+
+/* Loads a program from memory, as if from a .mc file holding these words.
+   Returns -1 if it does not fit, 0 otherwise. */
+int simLoadWords(simType* sim, const int* words, int numWords) {
+    if (numWords < 0 || numWords > NUMMEMORY) {
+        return -1;
+    }
+    memoryReset(&sim->mem);
+    for (int i = 0; i < numWords; ++i) {
+        storeInstr(&sim->mem, i, words[i]);
+    }
+    sim->mem.numMemory = numWords;
+    memoryShareImage(&sim->mem);
+    decodeMemory(&sim->mem);
+    startPipeline(sim);
+    return 0;
+}
+
+/* Loads a .mc, .mcb or assembly file. See loadMachineCode for out and
+   listing. On error the machine is left holding an empty program. */
+int simLoadFile(simType* sim, const char* filename, FILE* out, bool listing) {
+    if (loadMachineCode(&sim->mem, filename, out, listing) != 0) {
+        simLoadWords(sim, NULL, 0);
+        return -1;
+    }
+    startPipeline(sim);
+    return 0;
+}
+
+/* Continues from a checkpoint written by checkpointWrite, on the pipeline
+   variant that wrote it. */
+void simRestore(simType* sim, const char* checkpoint) {
+    stateType restored;
+    pipelineVariant variant;
+    checkpointRead(checkpoint, &sim->mem, &restored, &variant);
+    startPipeline(sim);
+    pipelineSetVariant(&sim->pipeline, variant);
+    *sim->pipeline.state = restored;
+    pipelineSync(&sim->pipeline);
+}
+
+static void runCycle(simType* sim) {
+    pipelineType* p = &sim->pipeline;
+    if (sim->onCycle != NULL) {
+        sim->onCycle(sim->onCycleCtx, p->state);
+    }
+    const stateType* before = p->state;
+    pipelineCycle(p);
+    if (!sim->watchStages || p->state == before) {
+        return;
+    }
+    const stateType* after = p->state;
+    int instrs[NUMSIMSTAGES] = {after->IFID.instr, before->IFID.instr, before->IDEX.instr,
+        before->EXMEM.instr, before->MEMWB.instr};
+    for (int stage = 0; stage < NUMSIMSTAGES; ++stage) {
+        if (sim->onStage[stage] != NULL) {
+            sim->onStage[stage](sim->onStageCtx[stage], stage, instrs[stage], before, after);
+        }
+    }
+}
+
+/* Runs up to cycles cycles, stopping early at halt. Returns how many ran. */
+unsigned long long simStep(simType* sim, unsigned long long cycles) {
+    unsigned long long ran = 0;
+    while (ran < cycles && !simHalted(sim)) {
+        runCycle(sim);
+        ++ran;
+    }
+    return ran;
+}
+
+/* Runs until the until condition holds for target, or until halt, and
+   returns which one stopped it. Nothing runs if it already holds. */
+simUntilType simRunUntil(simType* sim, simUntilType until, int target) {
+    while (!simHalted(sim)) {
+        if ((until == simUntilPc && simPc(sim) == target)
+                || (until == simUntilCycle && simCycles(sim) == (unsigned int) target)) {
+            return until;
+        }
+        runCycle(sim);
+    }
+    return simUntilHalt;
+}
+
+/* Executes instructions on the functional model (translated to native
+   code if jit is set) until maxInstrs have run, the next one is at
+   untilPc (NOPC for none), or the next one is halt. The pipeline must be
+   empty, as it is right after loading, and stays empty at the new pc.
+   Returns the number of instructions executed. */
+unsigned long long simFastForward(simType* sim, unsigned long long maxInstrs, int untilPc, bool jit) {
+    stateType* state = sim->pipeline.state;
+    return jit ? runJit(&sim->mem, &state->pc, state->reg, maxInstrs, untilPc)
+        : runFunctional(&sim->mem, &state->pc, state->reg, maxInstrs, untilPc);
+}
+
+void simOnCycle(simType* sim, simCycleFn fn, void* ctx) {
+    sim->onCycle = fn;
+    sim->onCycleCtx = ctx;
+}
+
+void simOnStage(simType* sim, simStageType stage, simStageFn fn, void* ctx) {
+    sim->onStage[stage] = fn;
+    sim->onStageCtx[stage] = ctx;
+    sim->watchStages = false;
+    for (int i = 0; i < NUMSIMSTAGES; ++i) {
+        sim->watchStages |= sim->onStage[i] != NULL;
+    }
+}
+
+/* Called with the address (wrapped into memory) and value of every sw. */
+void simOnStore(simType* sim, void (*fn)(void* ctx, int addr, int value), void* ctx) {
+    sim->pipeline.onStore = fn;
+    sim->pipeline.onStoreCtx = ctx;
+}
@@ -0,0 +1,116 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * The pipeline simulator as a library, for driving it from other programs
+ *
+ * A simType is one machine: its memory, its pipeline and the callbacks
+ * watching it. Any number can exist at once. simLoadFile and simRestore
+ * report bad files the way the simulator always has, by printing an error
+ * and exiting, and any call that allocates (simCreate, loading, running
+ * into a new memory page, simFastForward's JIT) does the same when it runs
+ * out of memory. Nothing else prints or exits. The simulator's command
+ * line is built on this API, and `make libsim.a` builds it as a static
+ * library.
+ *
+ *   simType* sim = simCreate();
+ *   simLoadWords(sim, words, numWords);
+ *   simRunUntil(sim, simUntilPc, 12);   // stop before fetching pc 12
+ *   int r1 = simReg(sim, 1);
+ *   simStep(sim, 5);                    // five more cycles
+ *   simRunUntil(sim, simUntilHalt, 0);
+ *   simFree(sim);
+ *
+ * A predictor, caches or counters can be attached to sim->pipeline as
+ * usual. Loading a program keeps them but does not reset them, and
+ * simFree leaves them to their owner.
+**/
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "lc2k.h"
+#include "pipeline.h"
+
+/* What simRunUntil runs to. Every run also stops at halt. */
+typedef enum {
+    simUntilHalt, // the halt has reached MEM/WB, where the simulator stops
+    simUntilPc, // the next cycle will fetch this pc
+    simUntilCycle, // this many cycles have run
+} simUntilType;
+
+typedef enum {
+    simStageIF,
+    simStageID,
+    simStageEX,
+    simStageMEM,
+    simStageWB,
+    NUMSIMSTAGES
+} simStageType;
+
+/* Called at the start of every cycle with the state before it runs. */
+typedef void (*simCycleFn)(void* ctx, stateType* state);
+
+/* Called after a cycle, once per stage in pipeline order, with the
+   instruction word that stage worked on and the states before and after
+   the cycle. Cycles frozen by a cache miss, where nothing moves, are not
+   reported. */
+typedef void (*simStageFn)(void* ctx, simStageType stage, int instr,
+    const stateType* before, const stateType* after);
+
+typedef struct simStruct {
+    memoryType mem;
+    pipelineType pipeline;
+    simCycleFn onCycle; // or NULL
+    void* onCycleCtx;
+    simStageFn onStage[NUMSIMSTAGES]; // or NULL
+    void* onStageCtx[NUMSIMSTAGES];
+    bool watchStages; // any onStage is set
+} simType;
+
+simType* simCreate(void);
+void simFree(simType*);
+
+int simLoadWords(simType*, const int* words, int numWords);
+int simLoadFile(simType*, const char* filename, FILE* out, bool listing);
+void simRestore(simType*, const char* checkpoint);
+
+unsigned long long simStep(simType*, unsigned long long cycles);
+simUntilType simRunUntil(simType*, simUntilType until, int target);
+unsigned long long simFastForward(simType*, unsigned long long maxInstrs, int untilPc, bool jit);
+
+void simOnCycle(simType*, simCycleFn, void* ctx);
+void simOnStage(simType*, simStageType, simStageFn, void* ctx);
+void simOnStore(simType*, void (*fn)(void* ctx, int addr, int value), void* ctx);
+
+static inline const stateType* simState(const simType* sim) {
+    return sim->pipeline.state;
+}
+
+static inline bool simHalted(const simType* sim) {
+    return pipelineHalted(&sim->pipeline);
+}
+
+static inline unsigned int simCycles(const simType* sim) {
+    return sim->pipeline.state->cycles;
+}
+
+static inline int simPc(const simType* sim) {
+    return sim->pipeline.state->pc;
+}
+
+static inline int simReg(const simType* sim, int reg) {
+    return sim->pipeline.state->reg[reg];
+}
+
+static inline void simSetReg(simType* sim, int reg, int value) {
+    sim->pipeline.state->reg[reg] = value;
+}
+
+static inline int simMem(const simType* sim, int addr) {
+    return loadWord(&sim->mem, addr);
+}
+
+static inline void simSetMem(simType* sim, int addr, int value) {
+    storeWord(&sim->mem, addr, value);
+}
+
+#endif
@@ -10,591 +10,611 @@
 #include <string.h>
 #include <stdbool.h>
 
-// Machine Definitions
-#define NUMMEMORY 65536 // maximum number of data words in memory
-#define NUMREGS 8 // number of machine registers
-
-#define ADD 0
-#define NOR 1
-#define LW 2
-#define SW 3
-#define BEQ 4
-#define JALR 5 // will not implemented for Project 3
-#define HALT 6
-#define NOOP 7
-
-const char* opcode_to_str_map[] = {
-    "add",
-    "nor",
-    "lw",
-    "sw",
-    "beq",
-    "jalr",
-    "halt",
-    "noop"
-};
-
-#define NOOPINSTR (NOOP << 22)
-
-typedef enum {
-    noHaz,
-    EXMEM,
-    MEMWB,
-    WBEND
-} HazType;
-
-typedef struct IFIDStruct {
-	int pcPlus1;
-	int instr;
-} IFIDType;
-
-typedef struct IDEXStruct {
-	int pcPlus1;
-	int valA;
-	int valB;
-	int offset;
-	int instr;
-    HazType valAhazType;
-    bool valAHaz;
-    bool valBHaz;
-    HazType valBhazType;
-} IDEXType;
-
-typedef struct EXMEMStruct {
-	int branchTarget;
-    int eq;
-	int aluResult;
-	int valB;
-	int instr;
-    HazType valAhazType;
-    bool valAHaz;
-    bool valBHaz;
-    HazType valBhazType;
-} EXMEMType;
-
-typedef struct MEMWBStruct {
-	int writeData;
-    int instr;
-    HazType valAhazType;
-    bool valAHaz;
-    bool valBHaz;
-    HazType valBhazType;
-} MEMWBType;
-
-typedef struct WBENDStruct {
-	int writeData;
-	int instr;
-    HazType valAhazType;
-    bool valAHaz;
-    bool valBHaz;
-    HazType valBhazType;
-} WBENDType;
-
-typedef struct stateStruct {
-	int pc;
-	int instrMem[NUMMEMORY];
-	int dataMem[NUMMEMORY];
-	int reg[NUMREGS];
-	unsigned int numMemory;
-	IFIDType IFID;
-	IDEXType IDEX;
-	EXMEMType EXMEM;
-	MEMWBType MEMWB;
-	WBENDType WBEND;
-	unsigned int cycles; // number of cycles run so far
-} stateType;
-
-typedef struct {
-    int opcode;
-    int regA;
-    int regB;
-    int destReg;
-} current5Instr;
-
-static inline int opcode(int instruction) {
-    return instruction>>22;
+#include "lc2k.h"
+#include "sim.h"
+#include "trace.h"
+#include "printer.h"
+#include "functional.h"
+#include "checkpoint.h"
+#include "pipeline.h"
+#include "batch.h"
+#include "loader.h"
+#include "wide.h"
+#include "lockstep.h"
+#include "multicore.h"
+#include "debugger.h"
+
+/* Command-line options. The defaults (every = 1, no range, no delta, no
+   fast-forward) reproduce the reference trace exactly. The final state is
+   always printed in full. */
+typedef struct optionsStruct {
+    bool quiet; // no per-cycle states at all
+    unsigned int every; // print cycles that are a multiple of this
+    unsigned int rangeStart; // print cycles in [rangeStart, rangeEnd]
+    unsigned int rangeEnd;
+    bool delta; // print only what changed since the last printed state
+    char* traceFile; // binary trace of every cycle, or NULL
+    unsigned long long fastForward; // instructions to run functionally first
+    int untilPc; // or run functionally until pc reaches this, NOPC for none
+    bool noJit; // fast-forward with the interpreter instead of translated code
+    char* checkpointFile; // save the state before checkpointCycle here
+    unsigned int checkpointCycle;
+    char* restoreFile; // start from this checkpoint instead of a program
+    char* batch; // directory or list of programs to check, or NULL
+    int jobs; // worker threads for batch
+    char* lockstep; // directory or list of data images to run the program over, or NULL
+    bool noListing; // skip the load-time instruction memory listing
+    char* saveMcb; // convert the program to .mcb here and exit, or NULL
+    bool predict; // use a branch predictor and report its statistics
+    predictorKind predictor;
+    int btbEntries;
+    char* statsJson; // write performance counters here, or NULL
+    cacheConfigType icache; // L1 caches, sizeWords 0 for none
+    cacheConfigType dcache;
+    int missLatency;
+    int width; // instructions issued per cycle, 1 or 2
+    pipelineVariant variant; // hazard and branch policies of the single-issue pipeline
+    bool setVariant; // --pipeline was given
+    int cores; // pipelines sharing dataMem, 0 for the usual single machine
+    char** programs; // machine-code files named on the command line
+    int numPrograms;
+    bool debug; // read debugger commands from stdin instead of running
+} optionsType;
+
+static inline bool shouldPrintCycle(const optionsType* opts, unsigned int cycle) {
+    return !opts->quiet && cycle >= opts->rangeStart && cycle <= opts->rangeEnd
+        && cycle % opts->every == 0;
 }
 
-static inline int field0(int instruction) {
-    return (instruction>>19) & 0x7;
-}
-
-static inline int field1(int instruction) {
-    return (instruction>>16) & 0x7;
-}
-
-static inline int field2(int instruction) {
-    return instruction & 0xFFFF;
+/* What the last printed state looked like, for --delta. dataMem is not
+   compared wholesale: sw records the words it touches in dirty[] and
+   only those are checked at print time. */
+typedef struct deltaStruct {
+    stateType last;
+    bool haveLast;
+    int lastDataMem[NUMMEMORY];
+    bool isDirty[NUMMEMORY];
+    int dirty[NUMMEMORY];
+    int numDirty;
+} deltaType;
+
+static inline void deltaNoteStore(deltaType* delta, int addr) {
+    if (addr >= 0 && addr < NUMMEMORY && !delta->isDirty[addr]) {
+        delta->isDirty[addr] = true;
+        delta->dirty[delta->numDirty++] = addr;
+    }
 }
 
-// convert a 16-bit number into a 32-bit Linux integer
-static inline int convertNum(int num) {
-    return num - ( (num & (1<<15)) ? 1<<16 : 0 );
+void printStateDelta(deltaType*, stateType*);
+void parseArgs(int, char*[], optionsType*, char**);
+
+/* What the command line watches the machine with. */
+typedef struct hooksStruct {
+    const optionsType* opts;
+    deltaType* delta; // or NULL
+    printerType* printer; // prints full states, or NULL
+    traceWriterType* trace; // or NULL
+} hooksType;
+
+/* Where sw writes go besides dataMem, for --delta, the printer and
+   --trace-bin. */
+static void noteStore(void* ctx, int addr, int value) {
+    hooksType* hooks = ctx;
+    if (hooks->delta != NULL) {
+        deltaNoteStore(hooks->delta, addr);
+    }
+    if (hooks->printer != NULL) {
+        printerNoteStore(hooks->printer, addr, value);
+    }
+    if (hooks->trace != NULL) {
+        traceNoteStore(hooks->trace, addr, value);
+    }
 }
 
-void printState(stateType*);
-void printInstruction(int);
-void readMachineCode(stateType*, char*);
-
-void current4InstrSetter(current5Instr* current4InstrArray, stateType* state, int stage) {
-    if (stage == 0) {
-        current4InstrArray[stage].opcode = opcode(state->IFID.instr);
-        current4InstrArray[stage].regA = field0(state->IFID.instr);
-        current4InstrArray[stage].regB = field1(state->IFID.instr);
-        current4InstrArray[stage].destReg = field2(state->IFID.instr);
-    } else if (stage == 1) {
-        current4InstrArray[stage].opcode = opcode(state->IDEX.instr);
-        current4InstrArray[stage].regA = field0(state->IDEX.instr);
-        current4InstrArray[stage].regB = field1(state->IDEX.instr);
-        current4InstrArray[stage].destReg = field2(state->IDEX.instr);
-    } else if (stage == 2) {
-        current4InstrArray[stage].opcode = opcode(state->EXMEM.instr);
-        current4InstrArray[stage].regA = field0(state->EXMEM.instr);
-        current4InstrArray[stage].regB = field1(state->EXMEM.instr);
-        current4InstrArray[stage].destReg = field2(state->EXMEM.instr);
-    } else if (stage == 3) {
-        current4InstrArray[stage].opcode = opcode(state->MEMWB.instr);
-        current4InstrArray[stage].regA = field0(state->MEMWB.instr);
-        current4InstrArray[stage].regB = field1(state->MEMWB.instr);
-        current4InstrArray[stage].destReg = field2(state->MEMWB.instr);
-    } else if (stage == -1) {
-        current4InstrArray[0].opcode = 7;
-        current4InstrArray[0].regA = 0;
-        current4InstrArray[0].regB = 0;
-        current4InstrArray[0].destReg = 0;
-    } else if (stage == -2) {
-        current4InstrArray[1].opcode = 7;
-        current4InstrArray[1].regA = 0;
-        current4InstrArray[1].regB = 0;
-        current4InstrArray[1].destReg = 0;
+/* Checkpoints, prints and traces the state before each cycle. */
+static void beforeCycle(void* ctx, stateType* state) {
+    hooksType* hooks = ctx;
+    const optionsType* opts = hooks->opts;
+    if (opts->checkpointFile != NULL && state->cycles == opts->checkpointCycle) {
+        checkpointWrite(opts->checkpointFile, state, opts->variant);
+    }
+    if (shouldPrintCycle(opts, state->cycles)) {
+        if (hooks->delta != NULL) {
+            printStateDelta(hooks->delta, state);
+        } else {
+            printerPushState(hooks->printer, state);
+        }
+    }
+    if (hooks->trace != NULL) {
+        traceWriteState(hooks->trace, state);
     }
 }
 
-void hazardResolver(stateType* state, int* valA, int* valB) {
-
-    if (!state->IDEX.valAHaz) {
-        *valA = state->IDEX.valA;
-    } else if (state->IDEX.valAHaz && state->IDEX.valAhazType == EXMEM) {
-        *valA = state->EXMEM.aluResult;
-    } else if (state->IDEX.valAHaz && state->IDEX.valAhazType == MEMWB) {
-        *valA = state->MEMWB.writeData;;
-    } else if (state->IDEX.valAHaz && state->IDEX.valAhazType == WBEND) {
-        *valA = state->WBEND.writeData;
+/* --width 2: runs the program on the dual-issue model, then on the scalar
+   pipeline from the same starting point to compare against. */
+static int runWide(memoryType* mem, const stateType* start) {
+    static memoryType scalarMem;
+    static widePipelineType wide;
+    static pipelineType scalar;
+    memoryShare(&scalarMem, mem);
+
+    widePipelineInit(&wide, mem, start->pc, start->reg);
+    while (!widePipelineHalted(&wide)) {
+        widePipelineCycle(&wide);
     }
-
-    if (!state->IDEX.valBHaz) {
-        *valB = state->IDEX.valB;
-    } else if (state->IDEX.valBHaz && state->IDEX.valBhazType == EXMEM) {
-        *valB = state->EXMEM.aluResult;
-    } else if (state->IDEX.valBHaz && state->IDEX.valBhazType == MEMWB) {
-        *valB = state->MEMWB.writeData;
-    } else if (state->IDEX.valBHaz && state->IDEX.valBhazType == WBEND) {
-        *valB = state->WBEND.writeData;
+    stateType view;
+    widePipelineLaneView(&wide, 0, &view);
+    printHalted(&view);
+    wideReport(&wide, stdout);
+
+    pipelineInit(&scalar, &scalarMem);
+    scalar.state->pc = start->pc;
+    memcpy(scalar.state->reg, start->reg, sizeof(start->reg));
+    scalar.counters = countersCreate();
+    while (!pipelineHalted(&scalar)) {
+        pipelineCycle(&scalar);
     }
+    unsigned long long instructions = scalar.counters->retired + 1;
+    unsigned int cycles = scalar.state->cycles;
+    printf("single issue: %llu instructions in %u cycles, IPC %.3f, dual issue speedup %.3f\n",
+        instructions, cycles, (double) instructions / cycles, (double) cycles / wide.state->cycles);
+    countersFree(scalar.counters);
+    return 0;
 }
 
-
 int main(int argc, char *argv[]) {
+    static deltaType delta;
+    optionsType opts;
+    char* filename;
+    parseArgs(argc, argv, &opts, &filename);
 
-    /* Declare state and newState.
-       Note these have static lifetime so that instrMem and
-       dataMem are not allocated on the stack. */
+    if (opts.batch != NULL) {
+        return runBatch(opts.batch, opts.jobs);
+    }
+    if (opts.lockstep != NULL) {
+        return runLockstep(filename, opts.lockstep);
+    }
+    if (opts.cores > 0) {
+        return runMulticore(opts.programs, opts.numPrograms, opts.cores, opts.jobs, !opts.noListing,
+            &opts.icache, &opts.dcache, opts.missLatency);
+    }
 
-    static stateType state, newState;
+    /* sim only holds the page tables; the pages themselves are allocated
+       as the program and its stores touch them. */
+    simType* sim = simCreate();
+    pipelineType* pipeline = &sim->pipeline;
+    pipelineSetVariant(pipeline, opts.variant);
+    if (opts.restoreFile != NULL) {
+        simRestore(sim, opts.restoreFile);
+        if (opts.setVariant && opts.variant != pipeline->variant) {
+            printf("error: %s was written by the %s pipeline, not %s\n", opts.restoreFile,
+                pipelineVariantName(pipeline->variant), pipelineVariantName(opts.variant));
+            exit(1);
+        }
+        opts.variant = pipeline->variant;
+        if (!opts.noListing) {
+            printf("instruction memory:\n");
+            for (int i = 0; i < sim->mem.numMemory; ++i) {
+                printInstrMemEntry(&sim->mem, i);
+            }
+        }
+        printf("restored %s at cycle %d\n", opts.restoreFile, simCycles(sim));
+    } else {
+        if (simLoadFile(sim, filename, stdout, !opts.noListing && opts.saveMcb == NULL) != 0) {
+            exit(1);
+        }
+        if (opts.saveMcb != NULL) {
+            saveMachineCodeBinary(&sim->mem, opts.saveMcb);
+            return 0;
+        }
 
-    if (argc != 2) {
-        printf("error: usage: %s <machine-code file>\n", argv[0]);
-        exit(1);
+        /* Skip ahead with the functional model. Everything it executes has
+           retired, so the pipeline starts empty at the next pc, exactly as
+           it does at cycle 0. */
+        if (opts.fastForward > 0 || opts.untilPc != NOPC) {
+            unsigned long long maxInstrs = opts.fastForward > 0 ? opts.fastForward : ~0ull;
+            unsigned long long count = simFastForward(sim, maxInstrs, opts.untilPc, !opts.noJit);
+            printf("fast-forwarded %llu instructions to pc %d\n", count, simPc(sim));
+        }
+        if (opts.width == 2) {
+            return runWide(&sim->mem, pipeline->state);
+        }
+    }
+    if (opts.debug) {
+        runDebugger(sim, stdin, stdout);
+        simFree(sim);
+        return 0;
     }
 
-    readMachineCode(&state, argv[1]);
-    current5Instr current4InstrArray[4];
-
-    // Initialize state here
-    state.pc = 0;
-    for (int i = 0; i < 8; i++) {
-        state.reg[i] = 0;
+    if (opts.statsJson != NULL) {
+        pipeline->counters = countersCreate();
+    }
+    if (opts.icache.sizeWords > 0) {
+        pipeline->icache = cacheCreate("icache", &opts.icache, opts.missLatency);
+    }
+    if (opts.dcache.sizeWords > 0) {
+        pipeline->dcache = cacheCreate("dcache", &opts.dcache, opts.missLatency);
+    }
+    if (opts.predict) {
+        pipeline->predictor = predictorCreate(opts.predictor, opts.btbEntries);
     }
-    state.IFID.instr = state.IDEX.instr = state.EXMEM.instr = state.MEMWB.instr = state.WBEND.instr = 0x1c00000;
-    newState = state;
-    bool stall = false;
-    //int stallCounter = 0;
 
-    while (opcode(state.MEMWB.instr) != HALT) {
-        printState(&state);
+    hooksType hooks = {&opts, NULL, NULL, NULL};
+    if (opts.delta) {
+        hooks.delta = &delta;
+    } else if (!opts.quiet) {
+        hooks.printer = printerCreate(stdout, &sim->mem);
+    }
+    if (opts.traceFile != NULL) {
+        hooks.trace = traceOpen(opts.traceFile, &sim->mem, simCycles(sim));
+    }
+    if (hooks.delta != NULL || hooks.printer != NULL || hooks.trace != NULL) {
+        simOnStore(sim, noteStore, &hooks);
+    }
+    simOnCycle(sim, beforeCycle, &hooks);
+    simRunUntil(sim, simUntilHalt, 0);
+    if (hooks.printer != NULL) {
+        printerFree(hooks.printer);
+    }
 
-        newState.cycles += 1;
+    stateType* state = pipeline->state;
+    if (opts.checkpointFile != NULL && state->cycles == opts.checkpointCycle) {
+        checkpointWrite(opts.checkpointFile, state, opts.variant);
+    }
+    printHalted(state);
+    if (pipeline->counters != NULL) {
+        countersWriteJson(pipeline->counters, opts.statsJson, state);
+        countersFree(pipeline->counters);
+    }
+    if (pipeline->predictor != NULL) {
+        predictorReport(pipeline->predictor, pipelineFlushPenalty(pipeline), stdout);
+        predictorFree(pipeline->predictor);
+    }
+    cacheType* caches[] = {pipeline->icache, pipeline->dcache};
+    for (int i = 0; i < 2; ++i) {
+        if (caches[i] != NULL) {
+            cacheReport(caches[i], stdout);
+            cacheFree(caches[i]);
+        }
+    }
+    if (hooks.trace != NULL) {
+        traceWriteHalt(hooks.trace);
+        traceWriteState(hooks.trace, state);
+        traceClose(hooks.trace);
+    }
+    simFree(sim);
+    return 0;
+}
 
-        /*if (stall) {
-            stallCounter--;
-            if (stallCounter == 0) {
-                stall = false;
-            }
-        } */
+static void usage(char* progName) {
+    printf("error: usage: %s [--quiet | --every N | --range A:B | --delta] [--trace-bin <file>]\n"
+        "\t[--fast-forward N] [--until-pc X] [--no-jit] [--checkpoint-at <cycle> <file>] [--no-listing]\n"
+        "\t[--predictor not-taken|btfn|bimodal|gshare] [--btb N] [--stats-json <file>]\n"
+        "\t[--icache S:B:W] [--dcache S:B:W] [--miss-latency N]\n"
+        "\t[--pipeline forward-mem|forward-ex|stall-mem|stall-ex]\n"
+        "\t<machine-code file> | --restore <file>\n"
+        "   or: %s --debug [--no-listing] [--fast-forward N] [--until-pc X] [--pipeline <variant>]\n"
+        "\t<machine-code file> | --restore <file>\n"
+        "   or: %s --width 2 [--no-listing] [--fast-forward N] [--until-pc X] <machine-code file>\n"
+        "   or: %s --batch <directory or list file> [-j N]\n"
+        "   or: %s --lockstep <directory or list of data images> <machine-code file>\n"
+        "   or: %s --cores N [-j N] [--no-listing] [--icache S:B:W] [--dcache S:B:W] [--miss-latency N]\n"
+        "\t<machine-code file> | <one machine-code file per core>\n"
+        "   or: %s --save-mcb <file.mcb> <machine-code file>\n", progName, progName, progName, progName, progName,
+        progName, progName);
+    exit(1);
+}
 
-        /* ---------------------- IF stage --------------------- */
-        if (state.EXMEM.eq == 1 && opcode(state.EXMEM.instr) == 4) {
-            newState.pc = state.EXMEM.branchTarget;
-            newState.IFID.pcPlus1 = state.EXMEM.branchTarget + 1;
-            newState.IFID.instr = 7<<22;
-        } else {
-            newState.pc = state.pc + 1;
-            newState.IFID.pcPlus1 = state.pc + 1;
-            newState.IFID.instr = state.instrMem[state.pc];
-        }
+static unsigned long long parseCount(char* progName, const char* str) {
+    char* end;
+    unsigned long long value = strtoull(str, &end, 10);
+    if (end == str || *end != '\0' || str[0] == '-') {
+        usage(progName);
+    }
+    return value;
+}
 
-        /* ---------------------- ID stage --------------------- */
-        if (!(state.EXMEM.eq == 1 && opcode(state.EXMEM.instr) == 4)) {
-            newState.IDEX.pcPlus1 = state.IFID.pcPlus1;
-            newState.IDEX.valA = state.reg[field0(state.IFID.instr)];
-            newState.IDEX.valB = state.reg[field1(state.IFID.instr)];
-            newState.IDEX.offset = convertNum(field2(state.IFID.instr));
-            newState.IDEX.instr = state.IFID.instr;
-
-            newState.IDEX.valAHaz = false;
-            newState.IDEX.valAhazType = noHaz;
-            newState.IDEX.valBHaz = false;
-            newState.IDEX.valBhazType = noHaz;
-
-             if ((opcode(state.IFID.instr) == 0) || (opcode(state.IFID.instr) == 1) || (opcode(state.IFID.instr) == 3) || (opcode(state.IFID.instr) == 4)) {   //current instruction is add or nor or sw or beq
-                for (int i = 2; i > -1; i--) {
-                    if (current4InstrArray[i].opcode == 0 || current4InstrArray[i].opcode == 1) { //if there was a previous intruction add or nor
-                        if (field0(state.IFID.instr) == current4InstrArray[i].destReg) {
-                            if (i == 0) {
-                                newState.IDEX.valAHaz = true;
-                                newState.IDEX.valAhazType = EXMEM;
-                            } else if (i == 1) {
-                                newState.IDEX.valAHaz = true;
-                                newState.IDEX.valAhazType = MEMWB;
-                            } else if (i == 2) {
-                                newState.IDEX.valAHaz = true;
-                                newState.IDEX.valAhazType = WBEND;
-                            }
-                        }
-                        if (field1(state.IFID.instr) == current4InstrArray[i].destReg) {
-                            if (i == 0) {
-                                newState.IDEX.valBHaz = true;
-                                newState.IDEX.valBhazType = EXMEM;
-                            } else if (i == 1) {
-                                newState.IDEX.valBHaz = true;
-                                newState.IDEX.valBhazType = MEMWB;
-                            } else if (i == 2) {
-                                newState.IDEX.valBHaz = true;
-                                newState.IDEX.valBhazType = WBEND;
-                            }
-                        }
-                    } else if (current4InstrArray[i].opcode == 2) {  //if there was a prev instr lw
-                        if (field0(state.IFID.instr) == current4InstrArray[i].regB) {
-                            if (i == 0) {
-                                stall = true;
-                                //stallCounter = 1;
-                                newState.IDEX.instr = 7<<22;
-                                newState.pc = state.pc;
-                                newState.IFID.pcPlus1 = state.pc;
-                                newState.IFID.instr = state.instrMem[state.pc-1];
-                                goto stallDetected;
-                            }
-                            else if (i == 1) {
-                                newState.IDEX.valAHaz = true;
-                                newState.IDEX.valAhazType = MEMWB;
-                            } else if (i == 2) {
-                                newState.IDEX.valAHaz = true;
-                                newState.IDEX.valAhazType = WBEND;
-                            }
-                        }
-                        if (field1(state.IFID.instr) == current4InstrArray[i].regB) {
-                            if (i == 0) {
-                                stall = true;
-                                //stallCounter = 1;
-                                newState.IDEX.instr = 7<<22;
-                                newState.pc = state.pc;
-                                newState.IFID.pcPlus1 = state.pc;
-                                newState.IFID.instr = state.instrMem[state.pc-1];
-                                goto stallDetected;
-                            } else if (i == 1) {
-                                newState.IDEX.valBHaz = true;
-                                newState.IDEX.valBhazType = MEMWB;
-                            } else if (i == 2) {
-                                newState.IDEX.valBHaz = true;
-                                newState.IDEX.valBhazType = WBEND;
-                            }
-                        }
-                    }
-                }
-            } else if (opcode(state.IFID.instr) == 2) {    //current instruction is lw
-                for (int i = 2; i > -1; i--) {
-                    if (current4InstrArray[i].opcode == 0 || current4InstrArray[i].opcode == 1) { //if there was a previous instruction add or nor
-                        if (field0(state.IFID.instr) == current4InstrArray[i].destReg) {
-                            if (i == 0) {
-                                newState.IDEX.valAHaz = true;
-                                newState.IDEX.valAhazType = EXMEM;
-                            } else if (i == 1) {
-                                newState.IDEX.valAHaz = true;
-                                newState.IDEX.valAhazType = MEMWB;
-                            } else if (i == 1) {
-                                newState.IDEX.valAHaz = true;
-                                newState.IDEX.valAhazType = WBEND;
-                            }
-                        }
-                    } else if (current4InstrArray[i].opcode == 2) {  //if there was a previous instruction lw
-                        if (field0(state.IFID.instr) == current4InstrArray[i].regB) {
-                            if (i == 0) {
-                                stall = true;
-                                //stallCounter = 1;
-                                newState.IDEX.instr = 7<<22;
-                                newState.pc = state.pc;
-                                newState.IFID.pcPlus1 = state.pc;
-                                newState.IFID.instr = state.instrMem[state.pc-1];
-                                goto stallDetected;
-                            } else if (i == 1) {
-                                newState.IDEX.valAHaz = true;
-                                newState.IDEX.valAhazType = MEMWB;
-                            } else if (i == 2) {
-                                newState.IDEX.valAHaz = true;
-                                newState.IDEX.valAhazType = WBEND;
-                            }
-                        }
-                    }
-                }
+void parseArgs(int argc, char* argv[], optionsType* opts, char** filename) {
+    opts->quiet = false;
+    opts->every = 1;
+    opts->rangeStart = 0;
+    opts->rangeEnd = ~0u;
+    opts->delta = false;
+    opts->traceFile = NULL;
+    opts->fastForward = 0;
+    opts->untilPc = NOPC;
+    opts->noJit = false;
+    opts->checkpointFile = NULL;
+    opts->checkpointCycle = 0;
+    opts->restoreFile = NULL;
+    opts->batch = NULL;
+    opts->jobs = 1;
+    opts->lockstep = NULL;
+    opts->noListing = false;
+    opts->saveMcb = NULL;
+    opts->predict = false;
+    opts->predictor = predictNotTaken;
+    opts->btbEntries = DEFAULTBTBENTRIES;
+    opts->statsJson = NULL;
+    opts->icache.sizeWords = 0;
+    opts->dcache.sizeWords = 0;
+    opts->missLatency = DEFAULTMISSLATENCY;
+    opts->width = 1;
+    opts->variant = pipelineForwardMem;
+    opts->setVariant = false;
+    opts->cores = 0;
+    opts->programs = malloc(argc * sizeof(char*));
+    opts->numPrograms = 0;
+    opts->debug = false;
+    *filename = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--quiet")) {
+            opts->quiet = true;
+        } else if (!strcmp(argv[i], "--no-listing")) {
+            opts->noListing = true;
+        } else if (!strcmp(argv[i], "--save-mcb") && i + 1 < argc) {
+            opts->saveMcb = argv[++i];
+        } else if (!strcmp(argv[i], "--predictor") && i + 1 < argc) {
+            if (!predictorParseKind(argv[++i], &opts->predictor)) {
+                usage(argv[0]);
             }
-stallDetected:
-            if (!stall) {
-                current4InstrSetter(current4InstrArray, &state, 0);
-            } else {
-                current4InstrSetter(current4InstrArray, &state, -1); // set 0th instr = noop
-                stall = false;
+            opts->predict = true;
+        } else if (!strcmp(argv[i], "--btb") && i + 1 < argc) {
+            opts->btbEntries = (int) parseCount(argv[0], argv[++i]);
+            if (opts->btbEntries <= 0 || (opts->btbEntries & (opts->btbEntries - 1)) != 0) {
+                usage(argv[0]);
             }
-        } else {
-            newState.IDEX.instr = 7<<22;
-            current4InstrSetter(current4InstrArray, &state, -1);
-        }
-        
-
-        /* ---------------------- EX stage --------------------- */
-        if (!(state.EXMEM.eq == 1 && opcode(state.EXMEM.instr) == 4)) {
-            const char* opcode_str = opcode_to_str_map[opcode(state.IDEX.instr)];
-            newState.EXMEM.branchTarget = state.IDEX.pcPlus1 + state.IDEX.offset;
-            int valA = 0;
-            int valB = 0;
-            hazardResolver(&state, &valA, &valB);
-            if (!strcmp(opcode_str, "add")) {
-                newState.EXMEM.aluResult = valA + valB;
-            }else if (!strcmp(opcode_str, "nor")) {
-                newState.EXMEM.aluResult = ~(valA | valB);
-            } else if (!strcmp(opcode_str, "lw") || !strcmp(opcode_str, "sw")) {
-                newState.EXMEM.aluResult = valA + state.IDEX.offset;
-            } else if (!strcmp(opcode_str, "beq")) {
-                if (valA == valB) {
-                    newState.EXMEM.eq = 1;
-                } else {
-                    newState.EXMEM.eq = 0;
-                }
+        } else if (!strcmp(argv[i], "--debug")) {
+            opts->debug = true;
+        } else if (!strcmp(argv[i], "--no-jit")) {
+            opts->noJit = true;
+        } else if (!strcmp(argv[i], "--delta")) {
+            opts->delta = true;
+        } else if (!strcmp(argv[i], "--every") && i + 1 < argc) {
+            opts->every = (unsigned int) parseCount(argv[0], argv[++i]);
+            if (opts->every == 0) {
+                usage(argv[0]);
             }
-            newState.EXMEM.valB = valB;
-            newState.EXMEM.instr = state.IDEX.instr;
-
-            current4InstrSetter(current4InstrArray, &state, 1);
+        } else if (!strcmp(argv[i], "--fast-forward") && i + 1 < argc) {
+            opts->fastForward = parseCount(argv[0], argv[++i]);
+        } else if (!strcmp(argv[i], "--until-pc") && i + 1 < argc) {
+            unsigned long long pc = parseCount(argv[0], argv[++i]);
+            if (pc >= NUMMEMORY) {
+                usage(argv[0]);
+            }
+            opts->untilPc = (int) pc;
+        } else if (!strcmp(argv[i], "--checkpoint-at") && i + 2 < argc) {
+            opts->checkpointCycle = (unsigned int) parseCount(argv[0], argv[++i]);
+            opts->checkpointFile = argv[++i];
+        } else if (!strcmp(argv[i], "--lockstep") && i + 1 < argc) {
+            opts->lockstep = argv[++i];
+        } else if (!strcmp(argv[i], "--batch") && i + 1 < argc) {
+            opts->batch = argv[++i];
+        } else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+            opts->jobs = (int) parseCount(argv[0], argv[++i]);
+        } else if (!strcmp(argv[i], "--restore") && i + 1 < argc) {
+            opts->restoreFile = argv[++i];
+        } else if (!strcmp(argv[i], "--icache") && i + 1 < argc) {
+            if (!cacheParseConfig(argv[++i], &opts->icache)) {
+                usage(argv[0]);
+            }
+        } else if (!strcmp(argv[i], "--dcache") && i + 1 < argc) {
+            if (!cacheParseConfig(argv[++i], &opts->dcache)) {
+                usage(argv[0]);
+            }
+        } else if (!strcmp(argv[i], "--miss-latency") && i + 1 < argc) {
+            opts->missLatency = (int) parseCount(argv[0], argv[++i]);
+        } else if (!strcmp(argv[i], "--width") && i + 1 < argc) {
+            opts->width = (int) parseCount(argv[0], argv[++i]);
+            if (opts->width != 1 && opts->width != 2) {
+                usage(argv[0]);
+            }
+        } else if (!strcmp(argv[i], "--pipeline") && i + 1 < argc) {
+            if (!pipelineParseVariant(argv[++i], &opts->variant)) {
+                usage(argv[0]);
+            }
+            opts->setVariant = true;
+        } else if (!strcmp(argv[i], "--cores") && i + 1 < argc) {
+            opts->cores = (int) parseCount(argv[0], argv[++i]);
+            if (opts->cores < 1 || opts->cores > MAXCORES) {
+                usage(argv[0]);
+            }
+        } else if (!strcmp(argv[i], "--stats-json") && i + 1 < argc) {
+            opts->statsJson = argv[++i];
+        } else if (!strcmp(argv[i], "--trace-bin") && i + 1 < argc) {
+            opts->traceFile = argv[++i];
+        } else if (!strcmp(argv[i], "--range") && i + 1 < argc) {
+            char* colon = strchr(argv[++i], ':');
+            if (colon == NULL) {
+                usage(argv[0]);
+            }
+            *colon = '\0';
+            opts->rangeStart = (unsigned int) parseCount(argv[0], argv[i]);
+            opts->rangeEnd = (unsigned int) parseCount(argv[0], colon + 1);
+            *colon = ':';
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
         } else {
-            newState.EXMEM.instr = 7<<22;
-            current4InstrSetter(current4InstrArray, &state, -2); // set 1st instr = noop
+            opts->programs[opts->numPrograms++] = argv[i];
+            *filename = opts->programs[0];
         }
-
-        /* --------------------- MEM stage --------------------- */
-        const char* opcode_str = opcode_to_str_map[opcode(state.EXMEM.instr)];
-        if (!strcmp(opcode_str, "add") || !strcmp(opcode_str, "nor")) {
-            newState.MEMWB.writeData = state.EXMEM.aluResult;
-        } else if (!strcmp(opcode_str, "lw")) {
-            newState.MEMWB.writeData = state.dataMem[state.EXMEM.aluResult];
-        } else if (!strcmp(opcode_str, "sw")) {
-            newState.dataMem[state.EXMEM.aluResult] = state.EXMEM.valB;
+    }
+    // only a multicore run takes more than one program
+    if (opts->numPrograms > 1 && opts->cores == 0) {
+        usage(argv[0]);
+    }
+    if (opts->batch != NULL) {
+        if (*filename != NULL || opts->restoreFile != NULL) {
+            usage(argv[0]);
         }
-        newState.MEMWB.instr = state.EXMEM.instr;
-
-        current4InstrSetter(current4InstrArray, &state, 2);
-
-        /* ---------------------- WB stage --------------------- */
-        opcode_str = opcode_to_str_map[opcode(state.MEMWB.instr)];
-        newState.WBEND.writeData = state.MEMWB.writeData;
-
-        if (!strcmp(opcode_str, "add") || !strcmp(opcode_str, "nor")) {
-            newState.reg[field2(state.MEMWB.instr)] = state.MEMWB.writeData;
-        } else if (!strcmp(opcode_str, "lw")) {
-            newState.reg[field1(state.MEMWB.instr)] = state.MEMWB.writeData;
+    } else if (opts->restoreFile != NULL) {
+        // a checkpoint already holds the program and may be mid-pipeline
+        if (*filename != NULL || opts->fastForward > 0 || opts->untilPc != NOPC) {
+            usage(argv[0]);
         }
+    } else if (*filename == NULL) {
+        usage(argv[0]);
+    }
+    // batch, lockstep, dual-issue and multicore runs build their own pipelines
+    if (opts->setVariant && (opts->batch != NULL || opts->lockstep != NULL || opts->width != 1
+            || opts->cores > 0 || opts->saveMcb != NULL)) {
+        usage(argv[0]);
+    }
+    // the dual-issue model prints only its final state and report
+    if (opts->width == 2 && (opts->batch != NULL || opts->restoreFile != NULL
+            || opts->every != 1 || opts->rangeStart != 0 || opts->rangeEnd != ~0u || opts->delta
+            || opts->traceFile != NULL || opts->checkpointFile != NULL || opts->predict
+            || opts->statsJson != NULL || opts->icache.sizeWords > 0 || opts->dcache.sizeWords > 0)) {
+        usage(argv[0]);
+    }
+    // a multicore run prints only its final state and report
+    if (opts->cores > 0 && (opts->batch != NULL || opts->lockstep != NULL || opts->restoreFile != NULL
+            || (opts->numPrograms != 1 && opts->numPrograms != opts->cores) || opts->width != 1
+            || opts->saveMcb != NULL || opts->fastForward > 0 || opts->untilPc != NOPC
+            || opts->quiet || opts->every != 1 || opts->rangeStart != 0 || opts->rangeEnd != ~0u || opts->delta
+            || opts->traceFile != NULL || opts->checkpointFile != NULL || opts->predict
+            || opts->statsJson != NULL || opts->jobs < 1)) {
+        usage(argv[0]);
+    }
+    // the debugger prints only what it is asked for, and keeps nothing
+    // but the pipeline itself in its snapshots
+    if (opts->debug && (opts->batch != NULL || opts->lockstep != NULL || opts->cores > 0 || opts->width != 1
+            || opts->saveMcb != NULL || opts->quiet || opts->every != 1 || opts->rangeStart != 0
+            || opts->rangeEnd != ~0u || opts->delta || opts->traceFile != NULL || opts->checkpointFile != NULL
+            || opts->predict || opts->statsJson != NULL || opts->icache.sizeWords > 0 || opts->dcache.sizeWords > 0)) {
+        usage(argv[0]);
+    }
+    // lockstep runs are functional only and print one final state per image
+    if (opts->lockstep != NULL && (opts->batch != NULL || opts->restoreFile != NULL || opts->width != 1
+            || opts->saveMcb != NULL || opts->fastForward > 0 || opts->untilPc != NOPC
+            || opts->every != 1 || opts->rangeStart != 0 || opts->rangeEnd != ~0u || opts->delta
+            || opts->traceFile != NULL || opts->checkpointFile != NULL || opts->predict
+            || opts->statsJson != NULL || opts->icache.sizeWords > 0 || opts->dcache.sizeWords > 0)) {
+        usage(argv[0]);
+    }
+}
 
-        newState.WBEND.instr = state.MEMWB.instr;
-
-        current4InstrSetter(current4InstrArray, &state, 3);
+static int compareInts(const void* a, const void* b) {
+    int x = *(const int*) a;
+    int y = *(const int*) b;
+    return (x > y) - (x < y);
+}
 
-        /* ------------------------ END ------------------------ */
-        state = newState; /* this is the last statement before end of the loop. It marks the end
-        of the cycle and updates the current state with the values calculated in this cycle */
+static void printInstrDelta(int oldInstr, int newInstr) {
+    if (oldInstr != newInstr) {
+        printf("\t\tinstruction = %d ( ", newInstr);
+        printInstruction(newInstr);
+        printf(" )\n");
     }
-    printf("Machine halted\n");
-    printf("Total of %d cycles executed\n", state.cycles);
-    printf("Final state of machine:\n");
-    printState(&state);
 }
 
-/*
-* DO NOT MODIFY ANY OF THE CODE BELOW.
-*/
-
-void printInstruction(int instr) {
-    const char* instr_opcode_str;
-    int instr_opcode = opcode(instr);
-    if(ADD <= instr_opcode && instr_opcode <= NOOP) {
-        instr_opcode_str = opcode_to_str_map[instr_opcode];
-    }
-
-    switch (instr_opcode) {
-        case ADD:
-        case NOR:
-        case LW:
-        case SW:
-        case BEQ:
-            printf("%s %d %d %d", instr_opcode_str, field0(instr), field1(instr), convertNum(field2(instr)));
-            break;
-        case JALR:
-            printf("%s %d %d", instr_opcode_str, field0(instr), field1(instr));
-            break;
-        case HALT:
-        case NOOP:
-            printf("%s", instr_opcode_str);
-            break;
-        default:
-            printf(".fill %d", instr);
-            return;
+static void printFieldDelta(const char* name, int oldVal, int newVal) {
+    if (oldVal != newVal) {
+        printf("\t\t%s = %d\n", name, newVal);
     }
 }
 
-void printState(stateType *statePtr) {
+/* Print only the registers, memory words and latch fields that differ
+   from the last state this function printed. The first call prints the
+   whole state in the usual format. */
+void printStateDelta(deltaType* delta, stateType* statePtr) {
+    memoryType* mem = statePtr->mem;
+    if (!delta->haveLast) {
+        printState(statePtr);
+        delta->last = *statePtr;
+        delta->haveLast = true;
+        for (int i = 0; i < mem->numMemory; ++i) {
+            delta->lastDataMem[i] = loadWord(mem, i);
+        }
+        return;
+    }
+    stateType* last = &delta->last;
+
     printf("\n@@@\n");
-    printf("state before cycle %d starts:\n", statePtr->cycles);
-    printf("\tpc = %d\n", statePtr->pc);
-
-    printf("\tdata memory:\n");
-    for (int i=0; i<statePtr->numMemory; ++i) {
-        printf("\t\tdataMem[ %d ] = %d\n", i, statePtr->dataMem[i]);
-    }
-    printf("\tregisters:\n");
-    for (int i=0; i<NUMREGS; ++i) {
-        printf("\t\treg[ %d ] = %d\n", i, statePtr->reg[i]);
-    }
-
-    // IF/ID
-    printf("\tIF/ID pipeline register:\n");
-    printf("\t\tinstruction = %d ( ", statePtr->IFID.instr);
-    printInstruction(statePtr->IFID.instr);
-    printf(" )\n");
-    printf("\t\tpcPlus1 = %d", statePtr->IFID.pcPlus1);
-    if(opcode(statePtr->IFID.instr) == NOOP){
-        printf(" (Don't Care)");
-    }
-    printf("\n");
-
-    // ID/EX
-    int idexOp = opcode(statePtr->IDEX.instr);
-    printf("\tID/EX pipeline register:\n");
-    printf("\t\tinstruction = %d ( ", statePtr->IDEX.instr);
-    printInstruction(statePtr->IDEX.instr);
-    printf(" )\n");
-    printf("\t\tpcPlus1 = %d", statePtr->IDEX.pcPlus1);
-    if(idexOp == NOOP){
-        printf(" (Don't Care)");
-    }
-    printf("\n");
-    printf("\t\treadRegA = %d", statePtr->IDEX.valA);
-    if (idexOp >= HALT || idexOp < 0) {
-        printf(" (Don't Care)");
-    }
-    printf("\n");
-    printf("\t\treadRegB = %d", statePtr->IDEX.valB);
-    if(idexOp == LW || idexOp > BEQ || idexOp < 0) {
-        printf(" (Don't Care)");
-    }
-    printf("\n");
-    printf("\t\toffset = %d", statePtr->IDEX.offset);
-    if (idexOp != LW && idexOp != SW && idexOp != BEQ) {
-        printf(" (Don't Care)");
-    }
-    printf("\n");
-
-    // EX/MEM
-    int exmemOp = opcode(statePtr->EXMEM.instr);
-    printf("\tEX/MEM pipeline register:\n");
-    printf("\t\tinstruction = %d ( ", statePtr->EXMEM.instr);
-    printInstruction(statePtr->EXMEM.instr);
-    printf(" )\n");
-    printf("\t\tbranchTarget %d", statePtr->EXMEM.branchTarget);
-    if (exmemOp != BEQ) {
-        printf(" (Don't Care)");
-    }
-    printf("\n");
-    printf("\t\teq ? %s", (statePtr->EXMEM.eq ? "True" : "False"));
-    if (exmemOp != BEQ) {
-        printf(" (Don't Care)");
-    }
-    printf("\n");
-    printf("\t\taluResult = %d", statePtr->EXMEM.aluResult);
-    if (exmemOp > SW || exmemOp < 0) {
-        printf(" (Don't Care)");
-    }
-    printf("\n");
-    printf("\t\treadRegB = %d", statePtr->EXMEM.valB);
-    if (exmemOp != SW) {
-        printf(" (Don't Care)");
-    }
-    printf("\n");
-
-    // MEM/WB
-	int memwbOp = opcode(statePtr->MEMWB.instr);
-    printf("\tMEM/WB pipeline register:\n");
-    printf("\t\tinstruction = %d ( ", statePtr->MEMWB.instr);
-    printInstruction(statePtr->MEMWB.instr);
-    printf(" )\n");
-    printf("\t\twriteData = %d", statePtr->MEMWB.writeData);
-    if (memwbOp >= SW || memwbOp < 0) {
-        printf(" (Don't Care)");
-    }
-    printf("\n");
-
-    // WB/END
-	int wbendOp = opcode(statePtr->WBEND.instr);
-    printf("\tWB/END pipeline register:\n");
-    printf("\t\tinstruction = %d ( ", statePtr->WBEND.instr);
-    printInstruction(statePtr->WBEND.instr);
-    printf(" )\n");
-    printf("\t\twriteData = %d", statePtr->WBEND.writeData);
-    if (wbendOp >= SW || wbendOp < 0) {
-        printf(" (Don't Care)");
-    }
-    printf("\n");
+    printf("state before cycle %d starts (changes since cycle %d):\n", statePtr->cycles, last->cycles);
+    if (last->pc != statePtr->pc) {
+        const char* label = memoryLabel(mem, statePtr->pc);
+        if (label != NULL) {
+            printf("\tpc = %d (%s)\n", statePtr->pc, label);
+        } else {
+            printf("\tpc = %d\n", statePtr->pc);
+        }
+    }
 
-    printf("end state\n");
-    fflush(stdout);
-}
+    qsort(delta->dirty, delta->numDirty, sizeof(int), compareInts);
+    for (int i = 0; i < delta->numDirty; ++i) {
+        int addr = delta->dirty[i];
+        int value = loadWord(mem, addr);
+        if (addr < mem->numMemory && delta->lastDataMem[addr] != value) {
+            printf("\tdataMem[ %d ] = %d\n", addr, value);
+        }
+        delta->lastDataMem[addr] = value;
+        delta->isDirty[addr] = false;
+    }
+    delta->numDirty = 0;
+
+    for (int i = 0; i < NUMREGS; ++i) {
+        if (last->reg[i] != statePtr->reg[i]) {
+            printf("\treg[ %d ] = %d\n", i, statePtr->reg[i]);
+        }
+    }
 
-// File
-#define MAXLINELENGTH 1000 // MAXLINELENGTH is the max number of characters we read
+    IFIDType* oldIFID = &last->IFID;
+    IFIDType* newIFID = &statePtr->IFID;
+    if (oldIFID->instr != newIFID->instr || oldIFID->pcPlus1 != newIFID->pcPlus1) {
+        printf("\tIF/ID pipeline register:\n");
+        printInstrDelta(oldIFID->instr, newIFID->instr);
+        printFieldDelta("pcPlus1", oldIFID->pcPlus1, newIFID->pcPlus1);
+    }
 
-void readMachineCode(stateType *state, char* filename) {
-    char line[MAXLINELENGTH];
-    FILE *filePtr = fopen(filename, "r");
-    if (filePtr == NULL) {
-        printf("error: can't open file %s", filename);
-        exit(1);
+    IDEXType* oldIDEX = &last->IDEX;
+    IDEXType* newIDEX = &statePtr->IDEX;
+    if (oldIDEX->instr != newIDEX->instr || oldIDEX->pcPlus1 != newIDEX->pcPlus1
+            || oldIDEX->valA != newIDEX->valA || oldIDEX->valB != newIDEX->valB
+            || oldIDEX->offset != newIDEX->offset) {
+        printf("\tID/EX pipeline register:\n");
+        printInstrDelta(oldIDEX->instr, newIDEX->instr);
+        printFieldDelta("pcPlus1", oldIDEX->pcPlus1, newIDEX->pcPlus1);
+        printFieldDelta("readRegA", oldIDEX->valA, newIDEX->valA);
+        printFieldDelta("readRegB", oldIDEX->valB, newIDEX->valB);
+        printFieldDelta("offset", oldIDEX->offset, newIDEX->offset);
     }
 
-    printf("instruction memory:\n");
-    for (state->numMemory = 0; fgets(line, MAXLINELENGTH, filePtr) != NULL; ++state->numMemory) {
-        if (sscanf(line, "%d", state->instrMem+state->numMemory) != 1) {
-            printf("error in reading address %d\n", state->numMemory);
-            exit(1);
+    EXMEMType* oldEXMEM = &last->EXMEM;
+    EXMEMType* newEXMEM = &statePtr->EXMEM;
+    if (oldEXMEM->instr != newEXMEM->instr || oldEXMEM->branchTarget != newEXMEM->branchTarget
+            || oldEXMEM->eq != newEXMEM->eq || oldEXMEM->aluResult != newEXMEM->aluResult
+            || oldEXMEM->valB != newEXMEM->valB) {
+        printf("\tEX/MEM pipeline register:\n");
+        printInstrDelta(oldEXMEM->instr, newEXMEM->instr);
+        if (oldEXMEM->branchTarget != newEXMEM->branchTarget) {
+            printf("\t\tbranchTarget %d\n", newEXMEM->branchTarget);
+        }
+        if (oldEXMEM->eq != newEXMEM->eq) {
+            printf("\t\teq ? %s\n", (newEXMEM->eq ? "True" : "False"));
         }
-        printf("\tinstrMem[ %d ]\t= 0x%08x\t= %d\t= ", state->numMemory, 
-            state->instrMem[state->numMemory], state->instrMem[state->numMemory]);
-        printInstruction(state->dataMem[state->numMemory] = state->instrMem[state->numMemory]);
-        printf("\n");
+        printFieldDelta("aluResult", oldEXMEM->aluResult, newEXMEM->aluResult);
+        printFieldDelta("readRegB", oldEXMEM->valB, newEXMEM->valB);
+    }
+
+    MEMWBType* oldMEMWB = &last->MEMWB;
+    MEMWBType* newMEMWB = &statePtr->MEMWB;
+    if (oldMEMWB->instr != newMEMWB->instr || oldMEMWB->writeData != newMEMWB->writeData) {
+        printf("\tMEM/WB pipeline register:\n");
+        printInstrDelta(oldMEMWB->instr, newMEMWB->instr);
+        printFieldDelta("writeData", oldMEMWB->writeData, newMEMWB->writeData);
+    }
+
+    WBENDType* oldWBEND = &last->WBEND;
+    WBENDType* newWBEND = &statePtr->WBEND;
+    if (oldWBEND->instr != newWBEND->instr || oldWBEND->writeData != newWBEND->writeData) {
+        printf("\tWB/END pipeline register:\n");
+        printInstrDelta(oldWBEND->instr, newWBEND->instr);
+        printFieldDelta("writeData", oldWBEND->writeData, newWBEND->writeData);
     }
+    printf("end state\n");
+
+    *last = *statePtr;
 }
+
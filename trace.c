@@ -0,0 +1,374 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Compact binary pipeline traces, see trace.h for the file layout
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "trace.h"
+
+static const char traceMagic[8] = "LC2KTRC";
+
+static const size_t traceFieldOffsets[NUMTRACEFIELDS] = {
+    offsetof(stateType, pc),
+    offsetof(stateType, IFID.instr),
+    offsetof(stateType, IFID.pcPlus1),
+    offsetof(stateType, IDEX.instr),
+    offsetof(stateType, IDEX.pcPlus1),
+    offsetof(stateType, IDEX.valA),
+    offsetof(stateType, IDEX.valB),
+    offsetof(stateType, IDEX.offset),
+    offsetof(stateType, EXMEM.instr),
+    offsetof(stateType, EXMEM.branchTarget),
+    offsetof(stateType, EXMEM.eq),
+    offsetof(stateType, EXMEM.aluResult),
+    offsetof(stateType, EXMEM.valB),
+    offsetof(stateType, MEMWB.instr),
+    offsetof(stateType, MEMWB.writeData),
+    offsetof(stateType, WBEND.instr),
+    offsetof(stateType, WBEND.writeData),
+};
+
+const char* traceFieldNames[NUMTRACEFIELDS] = {
+    "pc",
+    "IF/ID instruction",
+    "IF/ID pcPlus1",
+    "ID/EX instruction",
+    "ID/EX pcPlus1",
+    "ID/EX readRegA",
+    "ID/EX readRegB",
+    "ID/EX offset",
+    "EX/MEM instruction",
+    "EX/MEM branchTarget",
+    "EX/MEM eq",
+    "EX/MEM aluResult",
+    "EX/MEM readRegB",
+    "MEM/WB instruction",
+    "MEM/WB writeData",
+    "WB/END instruction",
+    "WB/END writeData",
+};
+
+int* traceField(stateType* state, int field) {
+    return (int*) ((char*) state + traceFieldOffsets[field]);
+}
+
+/* What each field would be if the machine just advanced one cycle with no
+   stall, branch or forwarding. pred[0] (pc) must already be filled in with
+   the actual new pc, since IF/ID pcPlus1 is predicted from it. */
+static void predictFields(stateType* old, memoryType* mem, int newPc, int* pred) {
+    int fetched = old->pc >= 0 && old->pc < NUMMEMORY ? fetchWord(mem, old->pc) : 0;
+    pred[0] = old->pc + 1;
+    pred[1] = fetched;
+    pred[2] = newPc;
+    pred[3] = old->IFID.instr;
+    pred[4] = old->IFID.pcPlus1;
+    pred[5] = old->reg[field0(old->IFID.instr)];
+    pred[6] = old->reg[field1(old->IFID.instr)];
+    pred[7] = convertNum(field2(old->IFID.instr));
+    pred[8] = old->IDEX.instr;
+    pred[9] = (int) ((unsigned int) old->IDEX.pcPlus1 + (unsigned int) old->IDEX.offset);
+    pred[10] = old->EXMEM.eq;
+    pred[11] = old->EXMEM.aluResult;
+    pred[12] = old->IDEX.valB;
+    pred[13] = old->EXMEM.instr;
+    pred[14] = old->EXMEM.aluResult;
+    pred[15] = old->MEMWB.instr;
+    pred[16] = old->MEMWB.writeData;
+}
+
+/* ------------------------- encoding ------------------------- */
+
+static inline unsigned int zigzag(int a, int b) {
+    int diff = (int) ((unsigned int) a - (unsigned int) b);
+    return ((unsigned int) diff << 1) ^ (unsigned int) (diff >> 31);
+}
+
+static inline int unzigzag(unsigned int z, int base) {
+    int diff = (int) ((z >> 1) ^ (0u - (z & 1)));
+    return (int) ((unsigned int) base + (unsigned int) diff);
+}
+
+static inline void putVarint(FILE* file, unsigned int value) {
+    while (value >= 0x80) {
+        putc((int) (value & 0x7f) | 0x80, file);
+        value >>= 7;
+    }
+    putc((int) value, file);
+}
+
+static void putU32(FILE* file, unsigned int value) {
+    for (int i = 0; i < 4; ++i) {
+        putc((int) ((value >> (8 * i)) & 0xff), file);
+    }
+}
+
+static void traceGrowStores(int** addrs, int** values, int* maxStores) {
+    *maxStores = *maxStores ? *maxStores * 2 : 16;
+    *addrs = realloc(*addrs, *maxStores * sizeof(int));
+    if (values != NULL) {
+        *values = realloc(*values, *maxStores * sizeof(int));
+    }
+    if (*addrs == NULL || (values != NULL && *values == NULL)) {
+        printf("error: out of memory for trace stores\n");
+        exit(1);
+    }
+}
+
+traceWriterType* traceOpen(const char* filename, memoryType* mem, unsigned int firstCycle) {
+    traceWriterType* trace = calloc(1, sizeof(traceWriterType));
+    if (trace == NULL) {
+        printf("error: out of memory for trace writer\n");
+        exit(1);
+    }
+    trace->file = fopen(filename, "wb");
+    if (trace->file == NULL) {
+        printf("error: can't open trace file %s\n", filename);
+        exit(1);
+    }
+    setvbuf(trace->file, NULL, _IOFBF, 1 << 20);
+    trace->mem = mem;
+
+    fwrite(traceMagic, 1, sizeof(traceMagic), trace->file);
+    putU32(trace->file, TRACE_VERSION);
+    putU32(trace->file, mem->numMemory);
+    putU32(trace->file, firstCycle);
+    for (unsigned int i = 0; i < mem->numMemory; ++i) {
+        putU32(trace->file, (unsigned int) fetchWord(mem, (int) i));
+    }
+
+    unsigned int numInit = 0;
+    for (int i = 0; i < NUMMEMORY; ++i) {
+        int expected = i < mem->numMemory ? fetchWord(mem, i) : 0;
+        numInit += loadWord(mem, i) != expected;
+    }
+    putVarint(trace->file, numInit);
+    for (int i = 0; i < NUMMEMORY; ++i) {
+        int expected = i < mem->numMemory ? fetchWord(mem, i) : 0;
+        if (loadWord(mem, i) != expected) {
+            putVarint(trace->file, (unsigned int) i);
+            putVarint(trace->file, zigzag(loadWord(mem, i), 0));
+        }
+    }
+    return trace;
+}
+
+void traceNoteStore(traceWriterType* trace, int addr, int value) {
+    if (trace->numStores == trace->maxStores) {
+        traceGrowStores(&trace->storeAddrs, &trace->storeValues, &trace->maxStores);
+    }
+    trace->storeAddrs[trace->numStores] = addr;
+    trace->storeValues[trace->numStores] = value;
+    ++trace->numStores;
+}
+
+void traceWriteState(traceWriterType* trace, stateType* state) {
+    FILE* file = trace->file;
+    stateType* old = &trace->last;
+    int pred[NUMTRACEFIELDS];
+    predictFields(old, trace->mem, state->pc, pred);
+
+    unsigned int fieldMask = 0;
+    for (int i = 0; i < NUMTRACEFIELDS; ++i) {
+        if (*traceField(state, i) != pred[i]) {
+            fieldMask |= 1u << i;
+        }
+    }
+    unsigned int regMask = 0;
+    for (int i = 0; i < NUMREGS; ++i) {
+        if (state->reg[i] != old->reg[i]) {
+            regMask |= 1u << i;
+        }
+    }
+
+    putc(TRACE_CYCLE, file);
+    putVarint(file, fieldMask);
+    putc((int) regMask, file);
+    putVarint(file, (unsigned int) trace->numStores);
+    for (int i = 0; i < NUMTRACEFIELDS; ++i) {
+        if (fieldMask & (1u << i)) {
+            putVarint(file, zigzag(*traceField(state, i), pred[i]));
+        }
+    }
+    for (int i = 0; i < NUMREGS; ++i) {
+        if (regMask & (1u << i)) {
+            putVarint(file, zigzag(state->reg[i], old->reg[i]));
+        }
+    }
+    for (int i = 0; i < trace->numStores; ++i) {
+        putVarint(file, (unsigned int) trace->storeAddrs[i]);
+        putVarint(file, zigzag(trace->storeValues[i], 0));
+    }
+    trace->numStores = 0;
+    *old = *state;
+}
+
+void traceWriteHalt(traceWriterType* trace) {
+    putc(TRACE_HALT, trace->file);
+}
+
+void traceClose(traceWriterType* trace) {
+    if (fclose(trace->file) != 0) {
+        printf("error: failed writing trace file\n");
+        exit(1);
+    }
+    free(trace->storeAddrs);
+    free(trace->storeValues);
+    free(trace);
+}
+
+/* ------------------------- decoding ------------------------- */
+
+static void traceCorrupt(traceReaderType* reader) {
+    printf("error: trace file %s is truncated or corrupt\n", reader->filename);
+    exit(1);
+}
+
+static inline unsigned int getVarint(traceReaderType* reader) {
+    unsigned int value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int c = getc(reader->file);
+        if (c == EOF) {
+            traceCorrupt(reader);
+        }
+        value |= (unsigned int) (c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            return value;
+        }
+    }
+    traceCorrupt(reader);
+    return 0;
+}
+
+static unsigned int getU32(traceReaderType* reader) {
+    unsigned int value = 0;
+    for (int i = 0; i < 4; ++i) {
+        int c = getc(reader->file);
+        if (c == EOF) {
+            traceCorrupt(reader);
+        }
+        value |= (unsigned int) c << (8 * i);
+    }
+    return value;
+}
+
+/* Fills in mem from the trace header: instrMem, numMemory and the initial
+   dataMem image. */
+traceReaderType* traceReaderOpen(const char* filename, memoryType* mem) {
+    traceReaderType* reader = calloc(1, sizeof(traceReaderType));
+    if (reader == NULL) {
+        printf("error: out of memory for trace reader\n");
+        exit(1);
+    }
+    reader->filename = filename;
+    reader->file = fopen(filename, "rb");
+    if (reader->file == NULL) {
+        printf("error: can't open trace file %s\n", filename);
+        exit(1);
+    }
+    setvbuf(reader->file, NULL, _IOFBF, 1 << 20);
+    reader->mem = mem;
+
+    char magic[sizeof(traceMagic)];
+    if (fread(magic, 1, sizeof(magic), reader->file) != sizeof(magic)
+            || memcmp(magic, traceMagic, sizeof(magic))) {
+        printf("error: %s is not an LC-2K trace file\n", filename);
+        exit(1);
+    }
+    unsigned int version = getU32(reader);
+    if (version != TRACE_VERSION) {
+        printf("error: %s has trace version %u, expected %d\n", filename, version, TRACE_VERSION);
+        exit(1);
+    }
+    memoryReset(mem);
+    mem->numMemory = getU32(reader);
+    if (mem->numMemory > NUMMEMORY) {
+        traceCorrupt(reader);
+    }
+    reader->firstCycle = getU32(reader);
+
+    for (unsigned int i = 0; i < mem->numMemory; ++i) {
+        storeInstr(mem, (int) i, (int) getU32(reader));
+    }
+    memoryShareImage(mem);
+    unsigned int numInit = getVarint(reader);
+    for (unsigned int i = 0; i < numInit; ++i) {
+        unsigned int addr = getVarint(reader);
+        if (addr >= NUMMEMORY) {
+            traceCorrupt(reader);
+        }
+        storeWord(mem, (int) addr, unzigzag(getVarint(reader), 0));
+    }
+
+    memset(&reader->state, 0, sizeof(reader->state));
+    reader->state.mem = mem;
+    return reader;
+}
+
+/* Reads the next record. Returns TRACE_CYCLE after updating reader->state
+   and mem, TRACE_HALT when the next record is the final state, or
+   TRACE_END at end of file. */
+int traceRead(traceReaderType* reader) {
+    int tag = getc(reader->file);
+    if (tag == EOF) {
+        return TRACE_END;
+    }
+    if (tag == TRACE_HALT) {
+        return TRACE_HALT;
+    }
+    if (tag != TRACE_CYCLE) {
+        traceCorrupt(reader);
+    }
+
+    stateType* state = &reader->state;
+    unsigned int fieldMask = getVarint(reader);
+    int regMask = getc(reader->file);
+    if (regMask == EOF) {
+        traceCorrupt(reader);
+    }
+    unsigned int numStores = getVarint(reader);
+
+    stateType old = *state;
+    int pred[NUMTRACEFIELDS];
+    int newPc = old.pc + 1;
+    if (fieldMask & 1u) {
+        newPc = unzigzag(getVarint(reader), newPc);
+    }
+    predictFields(&old, reader->mem, newPc, pred);
+    *traceField(state, 0) = newPc;
+    for (int i = 1; i < NUMTRACEFIELDS; ++i) {
+        *traceField(state, i) = (fieldMask & (1u << i))
+            ? unzigzag(getVarint(reader), pred[i]) : pred[i];
+    }
+    for (int i = 0; i < NUMREGS; ++i) {
+        if (regMask & (1 << i)) {
+            state->reg[i] = unzigzag(getVarint(reader), old.reg[i]);
+        }
+    }
+
+    reader->numStores = 0;
+    for (unsigned int i = 0; i < numStores; ++i) {
+        unsigned int addr = getVarint(reader);
+        if (addr >= NUMMEMORY) {
+            traceCorrupt(reader);
+        }
+        storeWord(reader->mem, (int) addr, unzigzag(getVarint(reader), 0));
+        if (reader->numStores == reader->maxStores) {
+            traceGrowStores(&reader->storeAddrs, NULL, &reader->maxStores);
+        }
+        reader->storeAddrs[reader->numStores++] = (int) addr;
+    }
+
+    state->cycles = reader->started ? old.cycles + 1 : reader->firstCycle;
+    reader->started = true;
+    return TRACE_CYCLE;
+}
+
+void traceReaderClose(traceReaderType* reader) {
+    fclose(reader->file);
+    free(reader->storeAddrs);
+    free(reader);
+}
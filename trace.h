@@ -0,0 +1,83 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Compact binary pipeline traces
+ *
+ * A trace file is a header followed by one record per simulated cycle.
+ *
+ * header:
+ *   "LC2KTRC\0"                     magic
+ *   u32 version, u32 numMemory, u32 firstCycle   (little-endian)
+ *   numMemory x i32                 instrMem[0..numMemory)
+ *   varint n, n x (varint addr, svarint value)
+ *                                   dataMem words that differ from
+ *                                   instrMem (or from 0 past numMemory)
+ *
+ * record:
+ *   u8 TRACE_CYCLE
+ *   varint fieldMask                which of the NUMTRACEFIELDS printed
+ *                                   fields differ from their prediction
+ *   u8 regMask                      which registers changed
+ *   varint numStores
+ *   svarint per set fieldMask bit   value - prediction
+ *   svarint per set regMask bit     value - old value
+ *   numStores x (varint addr, svarint value)
+ *
+ * TRACE_HALT is a single byte written just before the record of the final
+ * state. Most fields are predicted from the previous state (an instruction
+ * moves one latch forward each cycle, IF fetches instrMem[pc], and so on),
+ * so a typical cycle costs a handful of bytes instead of the ~1.5 KB that
+ * printState writes.
+**/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+#include "lc2k.h"
+
+#define TRACE_VERSION 1
+
+#define TRACE_CYCLE 1
+#define TRACE_HALT 2
+#define TRACE_END 0 // returned by traceRead at end of file
+
+#define NUMTRACEFIELDS 17 // pc plus the 16 latch fields printState shows
+
+extern const char* traceFieldNames[NUMTRACEFIELDS];
+
+typedef struct traceWriterStruct {
+    FILE* file;
+    memoryType* mem;
+    stateType last; // state as of the last record written
+    int* storeAddrs; // sw writes since the last record
+    int* storeValues;
+    int numStores;
+    int maxStores;
+} traceWriterType;
+
+typedef struct traceReaderStruct {
+    FILE* file;
+    const char* filename;
+    memoryType* mem;
+    stateType state; // state as of the last record read
+    unsigned int firstCycle;
+    bool started;
+    int* storeAddrs; // stores applied by the last record
+    int numStores;
+    int maxStores;
+} traceReaderType;
+
+traceWriterType* traceOpen(const char* filename, memoryType* mem, unsigned int firstCycle);
+void traceNoteStore(traceWriterType*, int addr, int value);
+void traceWriteState(traceWriterType*, stateType*);
+void traceWriteHalt(traceWriterType*);
+void traceClose(traceWriterType*);
+
+traceReaderType* traceReaderOpen(const char* filename, memoryType* mem);
+int traceRead(traceReaderType*);
+void traceReaderClose(traceReaderType*);
+
+int* traceField(stateType*, int field);
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * tracedump: turn a --trace-bin file back into the simulator's text output,
+ * or report the first cycle at which two traces differ.
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lc2k.h"
+#include "trace.h"
+
+static void dumpTrace(const char* filename) {
+    static memoryType mem;
+    traceReaderType* reader = traceReaderOpen(filename, &mem);
+
+    printf("instruction memory:\n");
+    for (int i = 0; i < mem.numMemory; ++i) {
+        printInstrMemEntry(&mem, i);
+    }
+
+    int tag;
+    while ((tag = traceRead(reader)) != TRACE_END) {
+        if (tag == TRACE_HALT) {
+            if (traceRead(reader) != TRACE_CYCLE) {
+                printf("error: trace file %s ends without a final state\n", filename);
+                exit(1);
+            }
+            printHalted(&reader->state);
+            continue;
+        }
+        printState(&reader->state);
+    }
+    traceReaderClose(reader);
+}
+
+/* Compares the words either trace stored to in its last record. */
+static int firstMemoryDifference(traceReaderType* a, traceReaderType* b) {
+    traceReaderType* readers[2] = {a, b};
+    for (int r = 0; r < 2; ++r) {
+        for (int i = 0; i < readers[r]->numStores; ++i) {
+            int addr = readers[r]->storeAddrs[i];
+            if (loadWord(a->mem, addr) != loadWord(b->mem, addr)) {
+                return addr;
+            }
+        }
+    }
+    return -1;
+}
+
+static int diffTraces(const char* fileA, const char* fileB) {
+    static memoryType memA, memB;
+    traceReaderType* a = traceReaderOpen(fileA, &memA);
+    traceReaderType* b = traceReaderOpen(fileB, &memB);
+
+    if (memA.numMemory != memB.numMemory) {
+        printf("traces differ before cycle 0: numMemory %u vs %u\n", memA.numMemory, memB.numMemory);
+        return 1;
+    }
+    for (int i = 0; i < NUMMEMORY; ++i) {
+        if (fetchWord(&memA, i) != fetchWord(&memB, i) || loadWord(&memA, i) != loadWord(&memB, i)) {
+            printf("traces differ before cycle 0: initial memory word %d\n", i);
+            return 1;
+        }
+    }
+
+    for (;;) {
+        int tagA = traceRead(a);
+        int tagB = traceRead(b);
+        stateType* sa = &a->state;
+        stateType* sb = &b->state;
+        if (tagA != tagB) {
+            const char* what[] = {"ends", "continues", "halts"};
+            printf("traces differ after cycle %d: %s %s, %s %s\n", sa->cycles,
+                fileA, what[tagA], fileB, what[tagB]);
+            return 1;
+        }
+        if (tagA == TRACE_END) {
+            break;
+        }
+        if (tagA == TRACE_HALT) {
+            continue;
+        }
+        if (sa->cycles != sb->cycles) {
+            printf("traces differ: cycle %d vs %d\n", sa->cycles, sb->cycles);
+            return 1;
+        }
+        for (int i = 0; i < NUMTRACEFIELDS; ++i) {
+            if (*traceField(sa, i) != *traceField(sb, i)) {
+                printf("traces differ at cycle %d: %s = %d vs %d\n", sa->cycles,
+                    traceFieldNames[i], *traceField(sa, i), *traceField(sb, i));
+                return 1;
+            }
+        }
+        for (int i = 0; i < NUMREGS; ++i) {
+            if (sa->reg[i] != sb->reg[i]) {
+                printf("traces differ at cycle %d: reg[ %d ] = %d vs %d\n", sa->cycles,
+                    i, sa->reg[i], sb->reg[i]);
+                return 1;
+            }
+        }
+        int addr = firstMemoryDifference(a, b);
+        if (addr >= 0) {
+            printf("traces differ at cycle %d: dataMem[ %d ] = %d vs %d\n", sa->cycles,
+                addr, loadWord(&memA, addr), loadWord(&memB, addr));
+            return 1;
+        }
+    }
+    printf("traces match through cycle %d\n", a->state.cycles);
+    traceReaderClose(a);
+    traceReaderClose(b);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 2) {
+        dumpTrace(argv[1]);
+        return 0;
+    }
+    if (argc == 3) {
+        return diffTraces(argv[1], argv[2]);
+    }
+    printf("error: usage: %s <trace file> [<trace file to compare against>]\n", argv[0]);
+    exit(1);
+}
@@ -0,0 +1,301 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Two-wide in-order variant of the five-stage pipeline
+**/
+
+#include <string.h>
+
+#include "wide.h"
+
+static const char* pairResultNames[NUMPAIRRESULTS] = {
+    "paired", "branch", "halt", "two memory ops", "dependency", "end of memory",
+};
+
+/* Latch an operand is forwarded from, by the distance of its producer. */
+static const HazType forwardSource[SCOREBOARDDEPTH] = {EXMEM, MEMWB, WBEND};
+
+static bool readsRegA(const decodedType* d) {
+    return d->opcode == ADD || d->opcode == NOR || d->opcode == LW || d->opcode == SW || d->opcode == BEQ;
+}
+
+static bool readsRegB(const decodedType* d) {
+    return d->opcode == ADD || d->opcode == NOR || d->opcode == SW || d->opcode == BEQ;
+}
+
+static bool isMemoryOp(const decodedType* d) {
+    return d->opcode == LW || d->opcode == SW;
+}
+
+static pairResult pairCheck(const decodedType* first, const decodedType* second) {
+    if (first->opcode == BEQ) {
+        return pairBranch;
+    }
+    if (first->opcode == HALT || second->opcode == HALT) {
+        return pairHalt;
+    }
+    if (isMemoryOp(first) && isMemoryOp(second)) {
+        return pairMemory;
+    }
+    int written = writtenReg(first);
+    if (written >= 0 && ((readsRegA(second) && second->regA == written)
+            || (readsRegB(second) && second->regB == written))) {
+        return pairDependency;
+    }
+    return pairOK;
+}
+
+/* Whether the instruction at pc may issue together with the next one. */
+static pairResult pairAt(const memoryType* mem, int pc) {
+    if (pc + 1 >= NUMMEMORY) {
+        return pairEndOfMemory;
+    }
+    return pairCheck(&mem->decoded[pc], &mem->decoded[pc + 1]);
+}
+
+static void setBubble(int* instr, int* instrIdx) {
+    *instr = NOOPINSTR;
+    *instrIdx = NOOPINDEX;
+}
+
+void widePipelineInit(widePipelineType* p, memoryType* mem, int pc, const int* reg) {
+    memset(p, 0, sizeof(*p));
+    p->mem = mem;
+    p->state = &p->stateBuf[0];
+    p->newState = &p->stateBuf[1];
+
+    wideStateType* state = p->state;
+    state->pc = pc;
+    memcpy(state->reg, reg, sizeof(state->reg));
+    for (int lane = 0; lane < ISSUEWIDTH; ++lane) {
+        setBubble(&state->IFID[lane].instr, &state->IFID[lane].instrIdx);
+        setBubble(&state->IDEX[lane].latch.instr, &state->IDEX[lane].latch.instrIdx);
+        setBubble(&state->EXMEM[lane].instr, &state->EXMEM[lane].instrIdx);
+        setBubble(&state->MEMWB[lane].instr, &state->MEMWB[lane].instrIdx);
+        setBubble(&state->WBEND[lane].instr, &state->WBEND[lane].instrIdx);
+    }
+}
+
+/* Sets an operand's forwarding fields from the scoreboard slot of its
+   producer, or clears them if slot is -1. */
+static void setForward(int slot, bool* haz, HazType* type, int* lane) {
+    *haz = slot >= 0;
+    *type = slot >= 0 ? forwardSource[slot / ISSUEWIDTH] : noHaz;
+    *lane = slot >= 0 ? ISSUEWIDTH - 1 - slot % ISSUEWIDTH : 0;
+}
+
+static int forwardedValue(const wideStateType* state, bool haz, HazType type, int lane, int value) {
+    if (!haz) {
+        return value;
+    } else if (type == EXMEM) {
+        return state->EXMEM[lane].aluResult;
+    } else if (type == MEMWB) {
+        return state->MEMWB[lane].writeData;
+    }
+    return state->WBEND[lane].writeData;
+}
+
+void widePipelineCycle(widePipelineType* p) {
+    memoryType* mem = p->mem;
+    const decodedType* decoded = mem->decoded;
+    wideStateType* state = p->state;
+    wideStateType* newState = p->newState;
+    scoreboardType* scoreboard = &p->scoreboard;
+
+    *newState = *state;
+    newState->cycles += 1;
+
+    /* ---------------------- IF stage --------------------- */
+    bool branchTaken = false;
+    int branchTarget = 0;
+    for (int lane = 0; lane < ISSUEWIDTH; ++lane) {
+        const EXMEMType* exmem = &state->EXMEM[lane];
+        if (decoded[exmem->instrIdx].opcode == BEQ && exmem->eq == 1) {
+            branchTaken = true;
+            branchTarget = exmem->branchTarget;
+        }
+    }
+
+    if (branchTaken) {
+        newState->pc = branchTarget;
+        for (int lane = 0; lane < ISSUEWIDTH; ++lane) {
+            newState->IFID[lane].pcPlus1 = branchTarget + 1;
+            setBubble(&newState->IFID[lane].instr, &newState->IFID[lane].instrIdx);
+        }
+    } else {
+        // a beq can send pc out of memory; fetch wraps it the way loadWord does
+        int pc = (unsigned int) state->pc % NUMMEMORY;
+        newState->IFID[0].pcPlus1 = pc + 1;
+        newState->IFID[0].instr = mem->decoded[pc].instr;
+        newState->IFID[0].instrIdx = pc;
+        if (pairAt(mem, pc) == pairOK) {
+            newState->pc = pc + 2;
+            newState->IFID[1].pcPlus1 = pc + 2;
+            newState->IFID[1].instr = mem->decoded[pc + 1].instr;
+            newState->IFID[1].instrIdx = pc + 1;
+        } else {
+            newState->pc = pc + 1;
+            newState->IFID[1].pcPlus1 = pc + 1;
+            setBubble(&newState->IFID[1].instr, &newState->IFID[1].instrIdx);
+        }
+    }
+
+    /* ---------------------- ID stage --------------------- */
+    bool stall = false;
+    for (int lane = 0; lane < ISSUEWIDTH; ++lane) {
+        const IFIDType* ifidLatch = &state->IFID[lane];
+        const decodedType* ifid = &decoded[ifidLatch->instrIdx];
+        wideIDEXType* idex = &newState->IDEX[lane];
+        if (branchTaken) {
+            setBubble(&idex->latch.instr, &idex->latch.instrIdx);
+            continue;
+        }
+        idex->latch.pcPlus1 = ifidLatch->pcPlus1;
+        idex->latch.valA = state->reg[ifid->regA];
+        idex->latch.valB = state->reg[ifid->regB];
+        idex->latch.offset = ifid->offset;
+        idex->latch.instr = ifidLatch->instr;
+        idex->latch.instrIdx = ifidLatch->instrIdx;
+
+        int producerA = readsRegA(ifid) ? scoreboardProducer(scoreboard, ifid->regA, 0) : -1;
+        int producerB = readsRegB(ifid) ? scoreboardProducer(scoreboard, ifid->regB, 0) : -1;
+        // a lw in ID/EX has nothing to forward until it has been through MEM
+        if ((producerA >= 0 && producerA < ISSUEWIDTH && (scoreboard->loads >> producerA & 1))
+                || (producerB >= 0 && producerB < ISSUEWIDTH && (scoreboard->loads >> producerB & 1))) {
+            stall = true;
+        }
+        setForward(producerA, &idex->latch.valAHaz, &idex->latch.valAhazType, &idex->valALane);
+        setForward(producerB, &idex->latch.valBHaz, &idex->latch.valBhazType, &idex->valBLane);
+    }
+
+    if (stall) {
+        p->loadUseStalls++;
+        newState->pc = state->pc;
+        for (int lane = 0; lane < ISSUEWIDTH; ++lane) {
+            newState->IFID[lane] = state->IFID[lane];
+            setBubble(&newState->IDEX[lane].latch.instr, &newState->IDEX[lane].latch.instrIdx);
+        }
+    } else if (branchTaken) {
+        p->flushes++;
+    } else if (state->IFID[0].instrIdx != NOOPINDEX) {
+        if (state->IFID[1].instrIdx != NOOPINDEX) {
+            p->pairedGroups++;
+        } else {
+            p->singleGroups++;
+            p->pairFailures[pairAt(mem, state->IFID[0].instrIdx)]++;
+        }
+    }
+
+    /* ---------------------- EX stage --------------------- */
+    for (int lane = 0; lane < ISSUEWIDTH; ++lane) {
+        const wideIDEXType* idexLatch = &state->IDEX[lane];
+        const decodedType* idex = &decoded[idexLatch->latch.instrIdx];
+        EXMEMType* exmem = &newState->EXMEM[lane];
+        if (branchTaken) {
+            setBubble(&exmem->instr, &exmem->instrIdx);
+            continue;
+        }
+        int valA = forwardedValue(state, idexLatch->latch.valAHaz, idexLatch->latch.valAhazType,
+            idexLatch->valALane, idexLatch->latch.valA);
+        int valB = forwardedValue(state, idexLatch->latch.valBHaz, idexLatch->latch.valBhazType,
+            idexLatch->valBLane, idexLatch->latch.valB);
+        exmem->branchTarget = idexLatch->latch.pcPlus1 + idexLatch->latch.offset;
+        switch (idex->opcode) {
+            case ADD:
+                exmem->aluResult = valA + valB;
+                break;
+            case NOR:
+                exmem->aluResult = ~(valA | valB);
+                break;
+            case LW:
+            case SW:
+                exmem->aluResult = valA + idexLatch->latch.offset;
+                break;
+            case BEQ:
+                exmem->eq = (valA == valB);
+                break;
+        }
+        exmem->valB = valB;
+        exmem->instr = idexLatch->latch.instr;
+        exmem->instrIdx = idexLatch->latch.instrIdx;
+    }
+
+    /* --------------------- MEM stage --------------------- */
+    for (int lane = 0; lane < ISSUEWIDTH; ++lane) {
+        const EXMEMType* exmemLatch = &state->EXMEM[lane];
+        MEMWBType* memwb = &newState->MEMWB[lane];
+        switch (decoded[exmemLatch->instrIdx].opcode) {
+            case ADD:
+            case NOR:
+                memwb->writeData = exmemLatch->aluResult;
+                break;
+            case LW:
+                memwb->writeData = loadWord(mem, exmemLatch->aluResult);
+                break;
+            case SW:
+                storeWord(mem, exmemLatch->aluResult, exmemLatch->valB);
+                break;
+        }
+        memwb->instr = exmemLatch->instr;
+        memwb->instrIdx = exmemLatch->instrIdx;
+    }
+
+    /* ---------------------- WB stage --------------------- */
+    // lane 1 writes last, so it wins when both lanes write one register
+    for (int lane = 0; lane < ISSUEWIDTH; ++lane) {
+        const MEMWBType* memwbLatch = &state->MEMWB[lane];
+        const decodedType* memwb = &decoded[memwbLatch->instrIdx];
+        int reg = writtenReg(memwb);
+        if (reg >= 0) {
+            newState->reg[reg] = memwbLatch->writeData;
+        }
+        if (memwbLatch->instrIdx != NOOPINDEX) {
+            p->retired++;
+        }
+        newState->WBEND[lane].writeData = memwbLatch->writeData;
+        newState->WBEND[lane].instr = memwbLatch->instr;
+        newState->WBEND[lane].instrIdx = memwbLatch->instrIdx;
+    }
+
+    /* ------------------------ END ------------------------ */
+    const decodedType* issued[ISSUEWIDTH];
+    for (int lane = 0; lane < ISSUEWIDTH; ++lane) {
+        issued[lane] = &decoded[newState->IDEX[lane].latch.instrIdx];
+    }
+    scoreboardAdvance(scoreboard, issued, ISSUEWIDTH);
+    if (branchTaken) {
+        // the pair that was in ID/EX has just been squashed out of EX/MEM
+        scoreboardSquash(scoreboard, ISSUEWIDTH, ISSUEWIDTH);
+    }
+
+    p->state = newState;
+    p->newState = state;
+}
+
+/* Fills a scalar stateType with one lane of the wide state, for printing. */
+void widePipelineLaneView(const widePipelineType* p, int lane, stateType* view) {
+    const wideStateType* state = p->state;
+    memset(view, 0, sizeof(*view));
+    view->mem = p->mem;
+    view->pc = state->pc;
+    memcpy(view->reg, state->reg, sizeof(view->reg));
+    view->IFID = state->IFID[lane];
+    view->IDEX = state->IDEX[lane].latch;
+    view->EXMEM = state->EXMEM[lane];
+    view->MEMWB = state->MEMWB[lane];
+    view->WBEND = state->WBEND[lane];
+    view->cycles = state->cycles;
+}
+
+void wideReport(const widePipelineType* p, FILE* out) {
+    unsigned long long instructions = p->retired + 1; // the halt is still in MEM/WB
+    unsigned int cycles = p->state->cycles;
+    fprintf(out, "dual issue: %llu instructions in %u cycles, IPC %.3f\n", instructions, cycles,
+        cycles ? (double) instructions / cycles : 0.0);
+    fprintf(out, "\tgroups issued %llu paired, %llu single; load-use stalls %llu, branch flushes %llu\n",
+        p->pairedGroups, p->singleGroups, p->loadUseStalls, p->flushes);
+    fprintf(out, "\tsingle issue because of:");
+    for (int i = pairOK + 1; i < NUMPAIRRESULTS; ++i) {
+        fprintf(out, "%s %s %llu", i == pairOK + 1 ? "" : ",", pairResultNames[i], p->pairFailures[i]);
+    }
+    fprintf(out, "\n");
+}
@@ -0,0 +1,77 @@
+/*
+ * EECS 370, University of Michigan, Fall 2023
+ * Two-wide in-order variant of the five-stage pipeline
+ *
+ * Every latch holds one instruction per lane; lane 0 is the older of a
+ * pair. IF fetches pc, and also pc + 1 when the two may issue together:
+ * a beq or halt ends its group, at most one of the pair may be a lw or
+ * sw, and the second may not read a register the first writes. The pair
+ * then moves through ID, EX, MEM and WB together. Operands are forwarded
+ * from either lane of EX/MEM, MEM/WB and WB/END, and a lw that is one
+ * stage ahead of either instruction stalls the whole pair. Branches are
+ * predicted not taken and resolved in MEM, as in the scalar pipeline.
+**/
+
+#ifndef WIDE_H
+#define WIDE_H
+
+#include <stdio.h>
+
+#include "lc2k.h"
+#include "scoreboard.h"
+
+#define ISSUEWIDTH 2
+
+/* Why two instructions did not issue together. */
+typedef enum {
+    pairOK,
+    pairBranch, // the first is a beq
+    pairHalt, // either is a halt
+    pairMemory, // both are lw or sw
+    pairDependency, // the second reads what the first writes
+    pairEndOfMemory, // the first is the last word of memory
+    NUMPAIRRESULTS
+} pairResult;
+
+typedef struct wideIDEXStruct {
+    IDEXType latch;
+    int valALane; // lane valA is forwarded from when latch.valAHaz
+    int valBLane;
+} wideIDEXType;
+
+typedef struct wideStateStruct {
+    int pc;
+    int reg[NUMREGS];
+    IFIDType IFID[ISSUEWIDTH];
+    wideIDEXType IDEX[ISSUEWIDTH];
+    EXMEMType EXMEM[ISSUEWIDTH];
+    MEMWBType MEMWB[ISSUEWIDTH];
+    WBENDType WBEND[ISSUEWIDTH];
+    unsigned int cycles;
+} wideStateType;
+
+typedef struct widePipelineStruct {
+    memoryType* mem;
+    wideStateType stateBuf[2];
+    wideStateType* state;
+    wideStateType* newState;
+    scoreboardType scoreboard;
+    unsigned long long retired; // instructions through WB, not counting the halt
+    unsigned long long pairedGroups;
+    unsigned long long singleGroups;
+    unsigned long long pairFailures[NUMPAIRRESULTS]; // by reason, for single groups
+    unsigned long long loadUseStalls;
+    unsigned long long flushes;
+} widePipelineType;
+
+void widePipelineInit(widePipelineType*, memoryType*, int pc, const int* reg);
+void widePipelineCycle(widePipelineType*);
+void widePipelineLaneView(const widePipelineType*, int lane, stateType*);
+void wideReport(const widePipelineType*, FILE*);
+
+static inline bool widePipelineHalted(const widePipelineType* p) {
+    // a halt always issues alone, in lane 0
+    return p->mem->decoded[p->state->MEMWB[0].instrIdx].opcode == HALT;
+}
+
+#endif